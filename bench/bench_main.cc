@@ -0,0 +1,273 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 13:00:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 13:00:00 
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "constant_folder.h"
+#include "file_io.h"
+#include "js_generator.h"
+#include "lexer.h"
+#include "obfuscator.h"
+#include "parser.h"
+
+namespace {
+
+enum Phase { TOKENIZE, PARSE, OBFUSCATE, GENERATE, PHASE_COUNT };
+constexpr const char* kPhaseNames[PHASE_COUNT] = { "tokenize", "parse", "obfuscate", "generate" };
+
+struct BenchOptions {
+    GeneratorOptions corpus;
+    int iterations = 5;
+    std::string jsonPath = "-";
+    std::string baselinePath;
+    double threshold = 1.5;
+    std::string corpusPath;
+};
+
+struct PhaseResult {
+    double bestMs = 0;
+    double medianMs = 0;
+    double mbPerSecond = 0;
+};
+
+struct BenchResult {
+    size_t inputBytes = 0;
+    size_t outputBytes = 0;
+    size_t tokens = 0;
+    size_t nodes = 0;
+    PhaseResult phases[PHASE_COUNT];
+};
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsBetween(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+// One full pipeline run with every phase timed separately. Each run starts
+// from fresh tables so no phase benefits from the previous iteration.
+void runOnce(const std::string& source, double (&ms)[PHASE_COUNT], BenchResult& result) {
+    AtomTable atoms;
+    Lexer lexer(source, atoms);
+    Clock::time_point t0 = Clock::now();
+    TokenStream tokens = lexer.tokenize();
+    Clock::time_point t1 = Clock::now();
+    result.tokens = tokens.size();
+    AST ast;
+    Parser parser(std::move(tokens), ast);
+    parser.parseProgram();
+    Clock::time_point t2 = Clock::now();
+    Obfuscator obfuscator(atoms);
+    foldConstants(ast, atoms);
+    obfuscator.obfuscate(ast);
+    Clock::time_point t3 = Clock::now();
+    std::string code = obfuscator.generateObfuscatedCode(ast);
+    Clock::time_point t4 = Clock::now();
+    result.nodes = ast.size();
+    result.outputBytes = code.size();
+
+    ms[TOKENIZE] = millisecondsBetween(t0, t1);
+    ms[PARSE] = millisecondsBetween(t1, t2);
+    ms[OBFUSCATE] = millisecondsBetween(t2, t3);
+    ms[GENERATE] = millisecondsBetween(t3, t4);
+}
+
+BenchResult runBench(const std::string& source, int iterations) {
+    BenchResult result;
+    result.inputBytes = source.size();
+    std::vector<double> samples[PHASE_COUNT];
+    for (int i = 0; i < iterations; ++i) {
+        double ms[PHASE_COUNT];
+        runOnce(source, ms, result);
+        for (int p = 0; p < PHASE_COUNT; ++p) samples[p].push_back(ms[p]);
+    }
+    double megabytes = static_cast<double>(source.size()) / (1 << 20);
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        std::vector<double>& s = samples[p];
+        std::sort(s.begin(), s.end());
+        PhaseResult& phase = result.phases[p];
+        // Best-of-N is the most stable figure on a shared machine.
+        phase.bestMs = s.front();
+        phase.medianMs = s[s.size() / 2];
+        phase.mbPerSecond = phase.bestMs > 0 ? megabytes / (phase.bestMs / 1000.0) : 0;
+    }
+    return result;
+}
+
+std::string toJson(const BenchOptions& options, const BenchResult& result) {
+    std::ostringstream json;
+    json.setf(std::ios::fixed);
+    json.precision(3);
+    json << "{\n"
+         << "  \"corpus\": {\"bytes\": " << result.inputBytes
+         << ", \"seed\": " << options.corpus.seed
+         << ", \"style\": \"" << (options.corpus.minified ? "minified" : "pretty") << "\""
+         << ", \"depth\": " << options.corpus.maxDepth
+         << ", \"strings\": " << options.corpus.stringCount << "},\n"
+         << "  \"iterations\": " << options.iterations << ",\n"
+         << "  \"tokens\": " << result.tokens << ",\n"
+         << "  \"nodes\": " << result.nodes << ",\n"
+         << "  \"output_bytes\": " << result.outputBytes << ",\n"
+         << "  \"phases\": {\n";
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        const PhaseResult& phase = result.phases[p];
+        json << "    \"" << kPhaseNames[p] << "\": {\"best_ms\": " << phase.bestMs
+             << ", \"median_ms\": " << phase.medianMs
+             << ", \"mb_per_s\": " << phase.mbPerSecond << "}"
+             << (p + 1 < PHASE_COUNT ? ",\n" : "\n");
+    }
+    json << "  }\n}\n";
+    return json.str();
+}
+
+// Finds "key": <number> after the first occurrence of "section". Enough for
+// the files toJson writes; not a general JSON parser.
+bool findNumber(const std::string& json, const std::string& section, const std::string& key, double& out) {
+    size_t at = json.find("\"" + section + "\"");
+    if (at == std::string::npos) return false;
+    at = json.find("\"" + key + "\"", at);
+    if (at == std::string::npos) return false;
+    at = json.find(':', at);
+    if (at == std::string::npos) return false;
+    const char* begin = json.c_str() + at + 1;
+    char* end = nullptr;
+    out = std::strtod(begin, &end);
+    return end != begin;
+}
+
+// Compares each phase's best throughput with the baseline. A phase fails
+// when it is more than threshold times slower.
+bool checkBaseline(const BenchOptions& options, const BenchResult& result) {
+    std::ifstream in(options.baselinePath);
+    if (!in) {
+        std::cerr << "Error: Cannot open baseline " << options.baselinePath << std::endl;
+        return false;
+    }
+    std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    double baselineBytes = 0;
+    if (!findNumber(json, "corpus", "bytes", baselineBytes) ||
+        static_cast<size_t>(baselineBytes) != result.inputBytes) {
+        std::cerr << "Error: Baseline was recorded for a different corpus ("
+                  << static_cast<size_t>(baselineBytes) << " bytes, now " << result.inputBytes
+                  << "); regenerate it with --json" << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        double baseline = 0;
+        if (!findNumber(json, kPhaseNames[p], "mb_per_s", baseline)) {
+            std::cerr << "Error: Baseline has no " << kPhaseNames[p] << " phase" << std::endl;
+            ok = false;
+            continue;
+        }
+        double limit = baseline / options.threshold;
+        double current = result.phases[p].mbPerSecond;
+        bool pass = current >= limit;
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-10s %10.1f MB/s  baseline %10.1f MB/s  limit %10.1f MB/s  %s",
+                      kPhaseNames[p], current, baseline, limit, pass ? "ok" : "REGRESSED");
+        std::cerr << line << std::endl;
+        ok = ok && pass;
+    }
+    return ok;
+}
+
+void printSummary(const BenchResult& result) {
+    std::cerr << "corpus " << result.inputBytes << " bytes, " << result.tokens << " tokens, "
+              << result.nodes << " nodes, output " << result.outputBytes << " bytes" << std::endl;
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        const PhaseResult& phase = result.phases[p];
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-10s best %9.3f ms  median %9.3f ms  %10.1f MB/s",
+                      kPhaseNames[p], phase.bestMs, phase.medianMs, phase.mbPerSecond);
+        std::cerr << line << std::endl;
+    }
+}
+
+void printUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+              << "  --size <MiB>          corpus size (default 4)\n"
+              << "  --seed <n>            generator seed (default 1)\n"
+              << "  --minified            generate minified code\n"
+              << "  --depth <n>           maximum block nesting (default 6)\n"
+              << "  --strings <n>         distinct string literals (default 4000)\n"
+              << "  --iterations <n>      runs per phase; the best is reported (default 5)\n"
+              << "  --json <path>         write results as JSON ('-' for stdout, the default)\n"
+              << "  --write-corpus <path> also save the generated corpus\n"
+              << "  --check <baseline>    fail if a phase is slower than baseline / threshold\n"
+              << "  --threshold <ratio>   allowed slowdown for --check (default 1.5)" << std::endl;
+}
+
+bool parseArgs(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--minified") {
+            options.corpus.minified = true;
+        } else if (arg == "--size" && hasValue) {
+            options.corpus.targetBytes = static_cast<size_t>(std::atof(argv[++i]) * (1 << 20));
+        } else if (arg == "--seed" && hasValue) {
+            options.corpus.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--depth" && hasValue) {
+            options.corpus.maxDepth = std::atoi(argv[++i]);
+        } else if (arg == "--strings" && hasValue) {
+            options.corpus.stringCount = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--iterations" && hasValue) {
+            options.iterations = std::atoi(argv[++i]);
+        } else if (arg == "--json" && hasValue) {
+            options.jsonPath = argv[++i];
+        } else if (arg == "--write-corpus" && hasValue) {
+            options.corpusPath = argv[++i];
+        } else if (arg == "--check" && hasValue) {
+            options.baselinePath = argv[++i];
+        } else if (arg == "--threshold" && hasValue) {
+            options.threshold = std::atof(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return options.iterations > 0 && options.threshold > 0 && options.corpus.stringCount > 0 &&
+           options.corpus.maxDepth >= 0 && options.corpus.targetBytes > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string source = generateJavaScript(options.corpus);
+    if (!options.corpusPath.empty() && !writeOutput(options.corpusPath, source)) {
+        std::cerr << "Error: Cannot write " << options.corpusPath << std::endl;
+        return 1;
+    }
+
+    BenchResult result = runBench(source, options.iterations);
+    printSummary(result);
+
+    // In check mode JSON is only written when asked for explicitly.
+    bool writeJson = options.baselinePath.empty() || options.jsonPath != "-";
+    if (writeJson && !writeOutput(options.jsonPath, toJson(options, result))) {
+        std::cerr << "Error: Cannot write " << options.jsonPath << std::endl;
+        return 1;
+    }
+    if (!options.baselinePath.empty() && !checkBaseline(options, result)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 13:00:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 13:00:00 
+ */
+#include "js_generator.h"
+#include <vector>
+
+namespace {
+
+constexpr const char* kWords[] = {
+    "get", "set", "data", "item", "value", "node", "list", "user", "count", "index",
+    "handler", "render", "update", "config", "cache", "state", "event", "key", "map", "buffer",
+    "parse", "load", "save", "query", "result", "token", "frame", "view", "model", "task"
+};
+constexpr size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+constexpr const char* kObjects[] = {
+    "api", "utils", "dom", "store", "router", "logger", "http", "cache", "events", "math"
+};
+constexpr size_t kObjectCount = sizeof(kObjects) / sizeof(kObjects[0]);
+
+constexpr const char* kOperators[] = { "+", "-", "*", "/" };
+
+// SplitMix64: tiny, fast and identical everywhere, unlike the standard
+// library distributions.
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+    bool percent(unsigned p) { return below(100) < p; }
+
+private:
+    uint64_t state;
+};
+
+class Generator {
+public:
+    explicit Generator(const GeneratorOptions& opts) : options(opts), rng(opts.seed) {
+        for (size_t i = 0; i < options.identifierCount; ++i) {
+            std::string name = kWords[rng.below(kWordCount)];
+            std::string second = kWords[rng.below(kWordCount)];
+            second[0] = static_cast<char>(second[0] - 'a' + 'A');
+            identifiers.push_back(name + second + std::to_string(i));
+        }
+        for (size_t i = 0; i < options.stringCount; ++i) {
+            strings.push_back(makeString());
+        }
+    }
+
+    std::string run() {
+        out.reserve(options.targetBytes + 4096);
+        while (out.size() < options.targetBytes) {
+            size_t kind = rng.below(10);
+            if (kind < 6) {
+                functionDeclaration(0);
+            } else if (kind < 8) {
+                statement(0, false);
+            } else {
+                callStatement(0);
+            }
+            newline(0);
+        }
+        return std::move(out);
+    }
+
+private:
+    std::string makeString() {
+        std::string s;
+        size_t words = 1 + rng.below(6);
+        for (size_t i = 0; i < words; ++i) {
+            if (i > 0) s += ' ';
+            s += kWords[rng.below(kWordCount)];
+        }
+        // A few escapes so the string scanner's slow path is exercised.
+        if (rng.percent(10)) s += "\\n";
+        if (rng.percent(5)) s += "\\\"quoted\\\"";
+        bool single = rng.percent(20);
+        return single ? "'" + s + "'" : "\"" + s + "\"";
+    }
+
+    const std::string& identifier() { return identifiers[rng.below(identifiers.size())]; }
+
+    void space() { if (!options.minified) out += ' '; }
+
+    void newline(int depth) {
+        if (options.minified) return;
+        out += '\n';
+        out.append(static_cast<size_t>(depth) * 2, ' ');
+    }
+
+    void expression(int depth) {
+        if (depth < options.maxDepth / 2 && rng.percent(40)) {
+            bool paren = rng.percent(30);
+            if (paren) out += '(';
+            expression(depth + 1);
+            space();
+            out += kOperators[rng.below(4)];
+            space();
+            expression(depth + 1);
+            if (paren) out += ')';
+            return;
+        }
+        size_t kind = rng.below(10);
+        if (kind < 4) {
+            out += identifier();
+        } else if (kind < 6) {
+            out += std::to_string(rng.below(100000));
+        } else if (kind < 8) {
+            out += strings[rng.below(strings.size())];
+        } else if (kind < 9) {
+            out += identifier();
+            arguments(depth + 1);
+        } else {
+            out += kObjects[rng.below(kObjectCount)];
+            out += '.';
+            out += identifier();
+            if (rng.percent(60)) arguments(depth + 1);
+        }
+    }
+
+    void arguments(int depth) {
+        out += '(';
+        size_t count = rng.below(4);
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) {
+                out += ',';
+                space();
+            }
+            expression(depth);
+        }
+        out += ')';
+    }
+
+    void callStatement(int depth) {
+        size_t kind = rng.below(3);
+        if (kind == 0) {
+            out += "console.log";
+        } else if (kind == 1) {
+            out += kObjects[rng.below(kObjectCount)];
+            out += '.';
+            out += identifier();
+        } else {
+            out += identifier();
+        }
+        arguments(depth / 2);
+        out += ';';
+    }
+
+    void block(int depth) {
+        out += '{';
+        size_t count = 1 + rng.below(depth + 1 < options.maxDepth ? 5 : 3);
+        for (size_t i = 0; i < count; ++i) {
+            newline(depth + 1);
+            statement(depth + 1, true);
+        }
+        newline(depth);
+        out += '}';
+    }
+
+    void statement(int depth, bool inFunction) {
+        size_t kind = rng.below(12);
+        bool canNest = depth < options.maxDepth;
+        if (canNest && kind < 2) {
+            out += "if";
+            space();
+            out += '(';
+            expression(depth / 2);
+            out += ')';
+            space();
+            block(depth);
+            if (rng.percent(40)) {
+                space();
+                out += "else";
+                space();
+                block(depth);
+            }
+        } else if (canNest && kind < 3) {
+            out += "while";
+            space();
+            out += '(';
+            expression(depth / 2);
+            out += ')';
+            space();
+            block(depth);
+        } else if (canNest && kind < 4) {
+            functionDeclaration(depth);
+        } else if (inFunction && kind < 5) {
+            out += "return ";
+            expression(depth / 2);
+            out += ';';
+        } else if (kind < 8) {
+            static constexpr const char* kDeclarations[] = { "var ", "let ", "const " };
+            out += kDeclarations[rng.below(3)];
+            out += identifier();
+            space();
+            out += '=';
+            space();
+            expression(depth / 2);
+            out += ';';
+        } else {
+            callStatement(depth);
+        }
+    }
+
+    void functionDeclaration(int depth) {
+        out += "function ";
+        out += identifier();
+        out += '(';
+        size_t params = rng.below(4);
+        for (size_t i = 0; i < params; ++i) {
+            if (i > 0) {
+                out += ',';
+                space();
+            }
+            out += identifier();
+        }
+        out += ')';
+        space();
+        block(depth);
+    }
+
+    const GeneratorOptions& options;
+    Rng rng;
+    std::vector<std::string> identifiers;
+    std::vector<std::string> strings;
+    std::string out;
+};
+
+} // namespace
+
+std::string generateJavaScript(const GeneratorOptions& options) {
+    return Generator(options).run();
+}
@@ -0,0 +1,35 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 13:00:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 13:00:00 
+ */
+#ifndef JS_GENERATOR_H
+#define JS_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Settings for the synthetic corpus. The same settings always produce the
+// same bytes on every platform, so benchmark results stay comparable.
+struct GeneratorOptions {
+    size_t targetBytes = 4 << 20;
+    uint64_t seed = 1;
+    // Strip optional whitespace and newlines, like bundler output.
+    bool minified = false;
+    // Maximum nesting of blocks; expressions nest up to half as deep.
+    int maxDepth = 6;
+    // Distinct string literals shared across the corpus.
+    size_t stringCount = 4000;
+    // Distinct identifiers shared across the corpus.
+    size_t identifierCount = 3000;
+};
+
+// Generates JavaScript limited to the constructs the parser understands:
+// function declarations, var/let/const, if/else, while, return, calls and
+// member calls, and arithmetic over names, numbers and strings. Output stops
+// at the first top-level statement boundary past targetBytes.
+std::string generateJavaScript(const GeneratorOptions& options);
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 10:15:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 10:15:00 
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Bump allocator for strings. Stored views stay valid until clear(),
+// reset() or destruction, which invalidate every view at once.
+class StringArena {
+public:
+    std::string_view store(std::string_view text);
+    void clear();
+    // Like clear(), but keeps the standard-size blocks for reuse.
+    void reset();
+    size_t bytesAllocated() const { return allocated; }
+
+private:
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;  // kBlockSize each
+    std::vector<std::unique_ptr<char[]>> oversized;
+    size_t nextBlock = 0;  // first block in blocks not yet handed out
+    char* cursor = nullptr;
+    size_t remaining = 0;
+    size_t allocated = 0;
+};
+
+#endif
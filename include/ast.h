@@ -0,0 +1,129 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 10:15:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 10:15:00 
+ */
+#ifndef AST_H
+#define AST_H
+
+#include <cstdint>
+#include <vector>
+#include "atom_table.h"
+
+enum class ASTNodeType : uint8_t {
+    PROGRAM,
+    FUNCTION_DECLARATION,
+    BLOCK,
+    RETURN_STATEMENT,
+    VARIABLE_DECLARATION,
+    FUNCTION_CALL,
+    MEMBER_EXPRESSION,
+    EXPRESSION,
+    IDENTIFIER,
+    NUMBER,
+    STRING,
+    KEYWORD,
+    IF_STATEMENT,
+    WHILE_STATEMENT,
+    FOR_LOOP,
+    WHILE_LOOP,
+    BINARY_EXPRESSION,
+    UNARY_EXPRESSION,
+    POSTFIX_EXPRESSION,
+    CONDITIONAL_EXPRESSION,
+    EMPTY
+};
+
+using NodeId = uint32_t;
+constexpr NodeId INVALID_NODE = UINT32_MAX;
+// Source offset of nodes that stand for no token, such as error placeholders.
+constexpr uint32_t kNoSourceOffset = UINT32_MAX;
+
+// Binding power of expressions, loosest first. PREC_SEQUENCE is the comma
+// operator. PREC_BRANCH is the else-branch of a conditional, which takes a
+// whole assignment: c ? a : b = 1 is c ? a : (b = 1). Calls, members and
+// leaves are PREC_PRIMARY.
+enum Precedence : uint8_t {
+    PREC_NONE,
+    PREC_SEQUENCE,
+    PREC_BRANCH,
+    PREC_ASSIGN,
+    PREC_CONDITIONAL,
+    PREC_OR,
+    PREC_AND,
+    PREC_BIT_OR,
+    PREC_BIT_XOR,
+    PREC_BIT_AND,
+    PREC_EQUALITY,
+    PREC_RELATIONAL,
+    PREC_SHIFT,
+    PREC_ADDITIVE,
+    PREC_MULTIPLICATIVE,
+    PREC_PREFIX,
+    PREC_POSTFIX,
+    PREC_PRIMARY
+};
+
+// Precedence of a binary operator atom, or PREC_NONE for anything else.
+// Assignments associate to the right, every other binary operator to the
+// left.
+uint8_t binaryPrecedence(Atom op);
+
+// Whether op can start a unary expression.
+bool isPrefixOperator(Atom op);
+
+// Children form a singly linked list through nextSibling; lastChild keeps
+// appends O(1).
+struct ASTNode {
+    ASTNodeType type;
+    Atom value;
+    NodeId firstChild = INVALID_NODE;
+    NodeId lastChild = INVALID_NODE;
+    NodeId nextSibling = INVALID_NODE;
+    uint32_t childCount = 0;
+};
+
+// Flat syntax tree. Nodes live contiguously and refer to each other by
+// 32-bit index, and values are atoms, so dropping the tree releases
+// everything in one step.
+//
+// addNode may reallocate node storage: keep NodeIds, not ASTNode references,
+// across calls that create nodes.
+//
+// Each node also records the byte offset in the source of the token it
+// starts at, for source maps. Offsets live beside the nodes rather than in
+// them, since only code generation with a source map reads them.
+class AST {
+public:
+    NodeId addNode(ASTNodeType type, Atom value, uint32_t sourceOffset);
+    // A missing child (INVALID_NODE) is kept as an EMPTY placeholder so
+    // operand positions stay stable after parse errors.
+    void appendChild(NodeId parent, NodeId child);
+
+    ASTNode& operator[](NodeId id) { return nodes[id]; }
+    const ASTNode& operator[](NodeId id) const { return nodes[id]; }
+
+    // Index-based access walks the sibling list; prefer iterating
+    // firstChild/nextSibling in loops.
+    NodeId child(NodeId parent, uint32_t index) const;
+
+    void setValue(NodeId id, Atom value) { nodes[id].value = value; }
+    uint32_t sourceOffset(NodeId id) const { return offsets[id]; }
+
+    NodeId root() const { return rootNode; }
+    void setRoot(NodeId id) { rootNode = id; }
+    size_t size() const { return nodes.size(); }
+    void reserve(size_t count) {
+        nodes.reserve(count);
+        offsets.reserve(count);
+    }
+    void clear();
+
+private:
+    std::vector<ASTNode> nodes;
+    std::vector<uint32_t> offsets;
+    NodeId rootNode = INVALID_NODE;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 22:05:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 22:05:00 
+ */
+#ifndef AST_FILE_H
+#define AST_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "atom_table.h"
+
+// Binary AST files hold a freshly parsed tree, so later runs can obfuscate
+// it with any options without lexing and parsing the source again.
+//
+// Every field is a little-endian u32 and every section starts 4-byte
+// aligned, so a mapped file can be read in place:
+//
+//   header     "CURSIAST", version, well-known atom count, node count,
+//              root, atom count, text bytes, line count, path bytes,
+//              source bytes
+//   nodes      type, value, firstChild, lastChild, nextSibling, childCount
+//   offsets    source offset of each node
+//   atom ends  end of each atom's text, for the atoms past the well-known
+//              ones, in id order
+//   lines      start of each source line, for source maps
+//   text       the atoms' text, back to back
+//   path       the source file's path, as given when saving
+//
+// Loading sizes the tree once and fills it in place, so it allocates
+// nothing per node; only the atoms are interned again, in their old order,
+// so they keep their ids.
+constexpr uint32_t kASTFileVersion = 2;
+
+// What an AST file records about the source it was parsed from.
+struct ASTFileSource {
+    std::string path;
+    std::vector<uint32_t> lineStarts;
+};
+
+// Writes ast, parsed from source at sourcePath with nothing done to it
+// since, and the atoms it refers to into out.
+void writeASTFile(const AST& ast, const AtomTable& atoms, std::string_view source, std::string_view sourcePath,
+                  std::string& out);
+
+// Replaces ast and atoms with the tree in data. Returns false with error
+// set, and ast and atoms left unusable until they are filled again, when
+// data is not a well-formed file of this version. Beyond the node links
+// and the children each node type needs, every node must hold an atom the
+// parser could have given it: an operator its type takes, or text that
+// lexes as one identifier, number or string. Offsets and line starts must
+// lie within the source. A damaged file is then either rejected or a tree
+// the obfuscator can generate code for.
+bool readASTFile(std::string_view data, AST& ast, AtomTable& atoms, ASTFileSource& source, std::string& error);
+
+#endif
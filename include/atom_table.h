@@ -0,0 +1,124 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 11:05:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 11:05:00 
+ */
+#ifndef ATOM_TABLE_H
+#define ATOM_TABLE_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "arena.h"
+
+using Atom = uint32_t;
+constexpr Atom INVALID_ATOM = UINT32_MAX;
+
+// Spellings every table interns up front, in this order, so the parser and
+// obfuscator can compare against them as constants.
+enum WellKnownAtom : Atom {
+    ATOM_EMPTY,
+    ATOM_IF,
+    ATOM_ELSE,
+    ATOM_FOR,
+    ATOM_WHILE,
+    ATOM_RETURN,
+    ATOM_FUNCTION,
+    ATOM_CONST,
+    ATOM_LET,
+    ATOM_VAR,
+    ATOM_LPAREN,
+    ATOM_RPAREN,
+    ATOM_LBRACE,
+    ATOM_RBRACE,
+    ATOM_SEMICOLON,
+    ATOM_COMMA,
+    ATOM_DOT,
+    ATOM_PLUS,
+    ATOM_MINUS,
+    ATOM_STAR,
+    ATOM_SLASH,
+    ATOM_ASSIGN,
+    ATOM_PROGRAM,
+    ATOM_BLOCK,
+    ATOM_CONSOLE,
+    ATOM_LOG,
+    ATOM_PERCENT,
+    ATOM_EQ,
+    ATOM_STRICT_EQ,
+    ATOM_NE,
+    ATOM_STRICT_NE,
+    ATOM_LT,
+    ATOM_LE,
+    ATOM_GT,
+    ATOM_GE,
+    ATOM_SHL,
+    ATOM_SHR,
+    ATOM_USHR,
+    ATOM_SHL_ASSIGN,
+    ATOM_SHR_ASSIGN,
+    ATOM_USHR_ASSIGN,
+    ATOM_PLUS_ASSIGN,
+    ATOM_MINUS_ASSIGN,
+    ATOM_STAR_ASSIGN,
+    ATOM_SLASH_ASSIGN,
+    ATOM_PERCENT_ASSIGN,
+    ATOM_BIT_AND_ASSIGN,
+    ATOM_BIT_OR_ASSIGN,
+    ATOM_BIT_XOR_ASSIGN,
+    ATOM_BIT_AND,
+    ATOM_BIT_OR,
+    ATOM_BIT_XOR,
+    ATOM_BIT_NOT,
+    ATOM_AND,
+    ATOM_OR,
+    ATOM_NOT,
+    ATOM_INCREMENT,
+    ATOM_DECREMENT,
+    ATOM_QUESTION,
+    ATOM_COLON,
+    ATOM_ASYNC,
+    ATOM_AWAIT,
+    ATOM_CLASS,
+    ATOM_NEW,
+    ATOM_THIS,
+    ATOM_SUPER,
+    ATOM_WELL_KNOWN_COUNT
+};
+
+// Intern table for identifiers, literals and punctuators. Each distinct
+// spelling is stored once and named by a dense 32-bit id, so equality is an
+// integer compare and per-name data can live in vectors indexed by atom.
+class AtomTable {
+public:
+    AtomTable();
+    AtomTable(const AtomTable&) = delete;
+    AtomTable& operator=(const AtomTable&) = delete;
+
+    Atom intern(std::string_view text);
+    // Returns INVALID_ATOM when text has never been interned.
+    Atom find(std::string_view text) const;
+    std::string_view str(Atom atom) const { return strings[atom]; }
+    size_t size() const { return strings.size(); }
+
+    // Drops everything except the well-known atoms.
+    void clear();
+    // Like clear(), but keeps the hash table and arena blocks at their
+    // current size for the next input.
+    void reset();
+
+private:
+    size_t probe(std::string_view text, uint64_t hash) const;
+    void grow();
+    void internWellKnown();
+
+    std::vector<std::string_view> strings;
+    std::vector<uint64_t> hashes;
+    std::vector<Atom> slots;  // open addressing; INVALID_ATOM marks a free slot
+    std::array<Atom, 256> singleChar;
+    StringArena arena;
+};
+
+#endif
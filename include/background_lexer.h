@@ -0,0 +1,67 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 15:40:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 15:40:00 
+ */
+#ifndef BACKGROUND_LEXER_H
+#define BACKGROUND_LEXER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "lexer.h"
+
+// Runs a token source on a thread of its own, at most kBatchCount batches
+// ahead of the consumer, so lexing overlaps parsing on large inputs.
+//
+// The wrapped source keeps running while the consumer works, so nothing
+// else may touch its state (for a Lexer, its AtomTable) until the consumer
+// has drained it or the BackgroundLexer is destroyed. Exceptions thrown by
+// the source are rethrown from fill() in the consumer.
+class BackgroundLexer final : public TokenSource {
+public:
+    explicit BackgroundLexer(TokenSource& source);
+    // Stops and joins the lexing thread, even if tokens are left unread.
+    ~BackgroundLexer() override;
+    BackgroundLexer(const BackgroundLexer&) = delete;
+    BackgroundLexer& operator=(const BackgroundLexer&) = delete;
+
+    size_t fill(const TokenSlots& out, size_t max) override;
+    std::string_view text() const override { return source.text(); }
+    size_t sizeHint() const override { return source.sizeHint(); }
+
+private:
+    static constexpr size_t kBatchTokens = 4096;
+    static constexpr size_t kBatchCount = 4;
+
+    struct Batch {
+        std::vector<TokenType> types;
+        std::vector<Atom> atoms;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> lengths;
+        size_t count = 0;
+    };
+
+    void produce();
+
+    TokenSource& source;
+    Batch batches[kBatchCount];
+    // Batches published and released so far; batch n lives in slot n % kBatchCount.
+    size_t produced = 0;
+    size_t consumed = 0;
+    size_t readPosition = 0;  // next token within the oldest published batch
+    bool finished = false;    // the producer published its last batch
+    bool stopping = false;    // the consumer went away
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable space;
+    std::thread thread;
+};
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 11:20:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 11:20:00 
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "obfuscator.h"
+
+class ResultCache;
+struct RunStats;
+
+struct BatchOptions {
+    // Each entry is a .js file, a directory (searched recursively for *.js,
+    // skipping earlier *.obf.js outputs) or "@manifest" (one path per line,
+    // blank lines and lines starting with '#' ignored).
+    std::vector<std::string> inputs;
+    // Empty: write <name>.obf.js next to each input. Otherwise outputs go
+    // under outDir, keeping the layout below any directory input.
+    std::string outDir;
+    // 0 uses one thread per core.
+    size_t threads = 0;
+    ObfuscatorOptions obfuscator;
+    // Also write a source map next to each output, as <output>.map. Not
+    // combinable with a cache, which keeps only the code.
+    bool sourceMaps = false;
+    // Optional; hits skip the whole pipeline. Its key must cover obfuscator.
+    ResultCache* cache = nullptr;
+    // Optional; receives the counters summed over every file. Phase times
+    // are summed across workers, so they exceed the wall time of the run.
+    RunStats* stats = nullptr;
+};
+
+// Obfuscates every input on a work-stealing pool. Each file gets its own
+// atom table, AST and obfuscator, so the output for a file is byte-identical
+// to a single-file run whatever the thread count. Returns the process exit
+// code: 0 when every file succeeded.
+int runBatch(const BatchOptions& options);
+
+#endif
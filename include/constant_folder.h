@@ -0,0 +1,30 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 19:30:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 19:30:00 
+ */
+#ifndef CONSTANT_FOLDER_H
+#define CONSTANT_FOLDER_H
+
+#include <cstddef>
+#include "ast.h"
+#include "atom_table.h"
+
+// Evaluates the expressions of a freshly parsed tree whose operands are all
+// literals, so the generated code does not redo them at run time:
+//
+//  - + - * / % on integer literals, when the result is an integer that a
+//    double holds exactly; negative results become a unary minus on a
+//    literal;
+//  - unary + and - on those, including what the above produced;
+//  - + with a string literal on either side, joining both into one string
+//    literal and so one string-table entry. x + "a" + "b" becomes x + "ab",
+//    since x + "a" is a string whatever x is.
+//
+// Folded nodes are rewritten in place and the operands they no longer need
+// are left unlinked. Must run before Obfuscator::obfuscate, which maps the
+// literals. Returns the number of expressions folded away.
+size_t foldConstants(AST& ast, AtomTable& atoms);
+
+#endif
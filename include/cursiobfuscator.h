@@ -0,0 +1,126 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 14:10:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 14:10:00 
+ */
+#ifndef CURSIOBFUSCATOR_H
+#define CURSIOBFUSCATOR_H
+
+/*
+ * C API of libcursiobfuscator.
+ *
+ * A context owns every buffer a run needs and reuses them for the next run,
+ * so a long-lived host should keep one context per thread. Contexts are
+ * independent: different threads may use different contexts at once, but
+ * one context must not be used by two threads at the same time.
+ *
+ * Only functions and types in this header are part of the stable interface.
+ * New options are appended to cursiobfuscator_options; callers must fill it
+ * with cursiobfuscator_options_init() so older binaries keep working.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(_WIN32) && defined(CURSIOBFUSCATOR_SHARED)
+#  ifdef CURSIOBFUSCATOR_BUILDING
+#    define CURSIOBFUSCATOR_API __declspec(dllexport)
+#  else
+#    define CURSIOBFUSCATOR_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__)
+#  define CURSIOBFUSCATOR_API __attribute__((visibility("default")))
+#else
+#  define CURSIOBFUSCATOR_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum cursiobfuscator_status {
+    CURSIOBFUSCATOR_OK = 0,
+    CURSIOBFUSCATOR_INVALID_ARGUMENT = 1,
+    /* The input could not be tokenized or parsed. */
+    CURSIOBFUSCATOR_INPUT_ERROR = 2,
+    CURSIOBFUSCATOR_OUT_OF_MEMORY = 3
+} cursiobfuscator_status;
+
+/* String-table encodings, from smallest and weakest to strongest. HEX is
+ * about 4x the size of the literals, SHUFFLE about 1x and BASE64 and XOR
+ * about 1.35x; BASE64 and XOR need atob() at run time. */
+typedef enum cursiobfuscator_string_encoding {
+    CURSIOBFUSCATOR_STRINGS_HEX = 0,
+    CURSIOBFUSCATOR_STRINGS_SHUFFLE = 1,
+    CURSIOBFUSCATOR_STRINGS_BASE64 = 2,
+    CURSIOBFUSCATOR_STRINGS_XOR = 3
+} cursiobfuscator_string_encoding;
+
+/* How renamed identifiers are spelled. SHORT renames per scope, gives the
+ * shortest names to the most used bindings and keeps global names. */
+typedef enum cursiobfuscator_name_style {
+    CURSIOBFUSCATOR_NAMES_HEX = 0,
+    CURSIOBFUSCATOR_NAMES_SHORT = 1
+} cursiobfuscator_name_style;
+
+/* struct_size tells the library which fields the caller knows about: a
+ * field is read only when it lies entirely within struct_size bytes, and
+ * the fields past it keep their defaults. */
+typedef struct cursiobfuscator_options {
+    /* Set by cursiobfuscator_options_init(). */
+    size_t struct_size;
+    /* Worker threads for large inputs. 0 or 1 runs on the calling thread. */
+    unsigned threads;
+    /* A cursiobfuscator_string_encoding; HEX by default. */
+    unsigned string_encoding;
+    /* A cursiobfuscator_name_style; HEX by default. */
+    unsigned name_style;
+    /* Nonzero drops the indentation, line breaks and optional spaces of
+     * the generated code; 0 by default. */
+    unsigned compact;
+} cursiobfuscator_options;
+
+typedef struct cursiobfuscator_context cursiobfuscator_context;
+
+/* Library version, e.g. "1.0". */
+CURSIOBFUSCATOR_API const char* cursiobfuscator_version(void);
+
+/* Fills options with the defaults. Inline, so struct_size is the size of
+ * the struct the caller was compiled with, never a newer library's. */
+static inline void cursiobfuscator_options_init(cursiobfuscator_options* options) {
+    if (!options) return;
+    memset(options, 0, sizeof(*options));
+    options->struct_size = sizeof(*options);
+    options->threads = 1;
+    options->string_encoding = CURSIOBFUSCATOR_STRINGS_HEX;
+    options->name_style = CURSIOBFUSCATOR_NAMES_HEX;
+    options->compact = 0;
+}
+
+/* Returns NULL on allocation failure, when options->struct_size is not
+ * recognized or when an option is out of range. options may be NULL for
+ * the defaults. */
+CURSIOBFUSCATOR_API cursiobfuscator_context* cursiobfuscator_context_new(const cursiobfuscator_options* options);
+CURSIOBFUSCATOR_API void cursiobfuscator_context_free(cursiobfuscator_context* context);
+
+/* Obfuscates input_size bytes of JavaScript. On success *output and
+ * *output_size describe the generated code, which is owned by the context
+ * and stays valid until the next call on it. On failure *output is NULL and
+ * cursiobfuscator_last_error() describes the problem. */
+CURSIOBFUSCATOR_API cursiobfuscator_status cursiobfuscator_obfuscate(
+    cursiobfuscator_context* context, const char* input, size_t input_size,
+    const char** output, size_t* output_size);
+
+/* Releases the last input's state but keeps allocated capacity. Optional:
+ * every call to cursiobfuscator_obfuscate starts from a clean state. */
+CURSIOBFUSCATOR_API void cursiobfuscator_context_reset(cursiobfuscator_context* context);
+
+/* Message for the last failed call on context, or "" after a success. */
+CURSIOBFUSCATOR_API const char* cursiobfuscator_last_error(const cursiobfuscator_context* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
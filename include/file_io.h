@@ -0,0 +1,39 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 09:40:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 09:40:00 
+ */
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only input buffer. Regular files are memory-mapped; stdin ("-") and
+// other streams are read into an owned buffer. data() stays valid until the
+// object is destroyed.
+class InputFile {
+public:
+    InputFile() = default;
+    ~InputFile();
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    bool open(const std::string& path);
+    std::string_view data() const { return view; }
+
+private:
+    void* mapped = nullptr;
+    size_t mappedSize = 0;
+    std::string buffer;
+    std::string_view view;
+};
+
+// Writes all chunks to path ("-" for stdout) with as few system calls as
+// possible. Returns false and leaves errno set on failure.
+bool writeOutput(const std::string& path, const std::vector<std::string_view>& chunks);
+bool writeOutput(const std::string& path, std::string_view data);
+
+#endif
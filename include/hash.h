@@ -0,0 +1,18 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 12:10:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 12:10:00 
+ */
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <string_view>
+
+// XXH64 (xxHash, 64-bit variant). Bit-compatible with the reference
+// implementation on little-endian hosts; used to key the result cache, so
+// it must stay stable across builds.
+uint64_t xxhash64(std::string_view data, uint64_t seed = 0);
+
+#endif
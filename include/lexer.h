@@ -7,30 +7,179 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
+#include "atom_table.h"
+#include "stats.h"
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     IDENTIFIER,
     KEYWORD,
     NUMBER,
     STRING,
     OPERATOR,
-    SYMBOL
+    SYMBOL,
+    // End-of-input sentinel the parser sees after the last token. Lexers
+    // never produce it, so it is not one of the kTokenTypeCount counted kinds.
+    END
 };
 
+// View of a single token. The value points into the source buffer the
+// tokens were produced from, so it is only valid while that buffer lives.
+// Keywords, operators and punctuators carry their fixed WellKnownAtom, so
+// they can be told apart with an integer switch.
 struct Token {
     TokenType type;
-    std::string value;
+    Atom atom;
+    std::string_view value;
 };
 
-class Lexer {
+// Struct-of-arrays destination for a run of tokens.
+struct TokenSlots {
+    TokenType* types;
+    Atom* atoms;
+    uint32_t* offsets;
+    uint32_t* lengths;
+};
+
+// Producer side of the lexer -> parser pipeline. Tokens are handed over in
+// batches, so the consumer pays one virtual call per batch, not per token.
+class TokenSource {
+public:
+    virtual ~TokenSource() = default;
+    // Writes up to max (> 0) tokens and returns how many were written; 0
+    // means the input is exhausted.
+    virtual size_t fill(const TokenSlots& out, size_t max) = 0;
+    // The buffer token offsets refer to.
+    virtual std::string_view text() const = 0;
+    // Expected token count for preallocation, or 0 when unknown.
+    virtual size_t sizeHint() const { return 0; }
+};
+
+// Packed token storage: one kind byte plus a 32-bit atom, offset and length
+// per token, kept as separate arrays and resolved against the source on access.
+class TokenStream {
+public:
+    TokenStream() = default;
+    explicit TokenStream(std::string_view source) : source(source) {}
+
+    void push(TokenType type, Atom atom, uint32_t offset, uint32_t length) {
+        types.push_back(type);
+        atoms.push_back(atom);
+        offsets.push_back(offset);
+        lengths.push_back(length);
+    }
+    // Empties the stream for a new source, keeping its capacity.
+    void reset(std::string_view newSource) {
+        source = newSource;
+        types.clear();
+        atoms.clear();
+        offsets.clear();
+        lengths.clear();
+    }
+    void reserve(size_t count) {
+        types.reserve(count);
+        atoms.reserve(count);
+        offsets.reserve(count);
+        lengths.reserve(count);
+    }
+
+    size_t size() const { return types.size(); }
+    bool empty() const { return types.empty(); }
+    std::string_view text() const { return source; }
+    TokenType type(size_t index) const { return types[index]; }
+    Atom atom(size_t index) const { return atoms[index]; }
+    uint32_t offset(size_t index) const { return offsets[index]; }
+    uint32_t length(size_t index) const { return lengths[index]; }
+    std::string_view value(size_t index) const { return source.substr(offsets[index], lengths[index]); }
+    Token operator[](size_t index) const { return { types[index], atoms[index], value(index) }; }
+
+    // Appends count uninitialized tokens and returns where they start; call
+    // truncate() afterwards to drop the ones that were not filled in.
+    TokenSlots extend(size_t count) {
+        size_t used = size();
+        types.resize(used + count);
+        atoms.resize(used + count);
+        offsets.resize(used + count);
+        lengths.resize(used + count);
+        return { &types[used], &atoms[used], &offsets[used], &lengths[used] };
+    }
+    void truncate(size_t count) {
+        types.resize(count);
+        atoms.resize(count);
+        offsets.resize(count);
+        lengths.resize(count);
+    }
+
+private:
+    std::string_view source;
+    std::vector<TokenType> types;
+    std::vector<Atom> atoms;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+};
+
+// Replays a materialized token stream.
+class TokenStreamSource final : public TokenSource {
 public:
-    Lexer(const std::string& source);
-    std::vector<Token> tokenize();
+    explicit TokenStreamSource(TokenStream tokens) : tokens(std::move(tokens)) {}
+
+    size_t fill(const TokenSlots& out, size_t max) override;
+    std::string_view text() const override { return tokens.text(); }
+    size_t sizeHint() const override { return tokens.size(); }
 
 private:
-    std::string sourceCode;
+    TokenStream tokens;
+    size_t next = 0;
 };
 
+class Lexer final : public TokenSource {
+public:
+    // The source is not copied; it must outlive the lexer and its tokens.
+    // Every token spelling is interned into atoms.
+    Lexer(std::string_view source, AtomTable& atoms);
+    // Scans the whole source up front.
+    TokenStream tokenize();
+    // Refills tokens, reusing their storage.
+    void tokenize(TokenStream& tokens);
+
+    // Pull interface: scans just enough of the source to fill out, which it
+    // fills completely unless the source runs out. Scanning continues where
+    // the previous call stopped; tokenize() restarts it.
+    size_t fill(const TokenSlots& out, size_t max) override;
+    std::string_view text() const override { return sourceCode; }
+    size_t sizeHint() const override { return sourceCode.size() / 4; }
+
+    // Has the lexer fill starts with the offset of every line it scans,
+    // for a source map: 0, then the byte after each '\n'. Call it before
+    // the first fill(); null stops recording.
+    void recordLineStarts(std::vector<uint32_t>* starts);
+
+#if CURSIOBFUSCATOR_STATS
+    const LexerStats& statistics() const { return stats; }
+#endif
+
+private:
+    void recordLines(const char* from, const char* to);
+
+    std::string_view sourceCode;
+    AtomTable& atoms;
+    size_t position = 0;
+    std::vector<uint32_t>* lineStarts = nullptr;
+    OBF_STAT(LexerStats stats;)
+};
+
+// Reads the UTF-8 sequence at p into codePoint. Surrogates are let through,
+// so lone ones from \u escapes survive a round trip. Returns its length, or
+// 0 when the bytes at p are not one.
+size_t decodeUtf8(const char* p, const char* end, uint32_t& codePoint);
+
+// Appends the value of a quoted string literal to out: the quotes are
+// dropped and escape sequences decoded, to UTF-8. Source bytes that are not
+// UTF-8 are read as Latin-1, so out always decodes with decodeUtf8.
+void appendStringValue(std::string& out, std::string_view literal);
+
 #endif
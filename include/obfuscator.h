@@ -7,34 +7,201 @@
 #ifndef OBFUSCATOR_H
 #define OBFUSCATOR_H
 
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
-#include <memory>
-#include <unordered_map>
-#include <unordered_set>
-#include "parser.h"
+#include "ast.h"
+#include "atom_table.h"
+#include "source_map.h"
+
+class ThreadPool;
+
+// How string-table entries are written to the output, from weakest and
+// smallest to strongest. Every encoding yields the same strings at run time.
+enum class StringEncoding : uint8_t {
+    HEX,      // every byte as a \xNN escape: about 4x the literal size
+    SHUFFLE,  // plain text in a permuted table: about 1x
+    BASE64,   // base64 decoded with atob(): about 1.35x
+    XOR       // base64 of the bytes XORed with a rotating 8-byte key: about 1.35x
+};
+
+// Parses "hex", "shuffle", "base64" or "xor".
+bool parseStringEncoding(std::string_view name, StringEncoding& encoding);
+const char* stringEncodingName(StringEncoding encoding);
+
+// How renamed identifiers are spelled.
+enum class NameStyle : uint8_t {
+    HEX,   // one _0xNNNNNN name per distinct identifier, program-wide
+    SHORT  // per-scope bindings, shortest names for the most used; globals kept
+};
+
+// Parses "hex" or "short".
+bool parseNameStyle(std::string_view name, NameStyle& style);
+const char* nameStyleName(NameStyle style);
+
+// Settings that change the generated code.
+struct ObfuscatorOptions {
+    StringEncoding strings = StringEncoding::HEX;
+    NameStyle names = NameStyle::HEX;
+    // Only the whitespace and semicolons the syntax needs, all on one line.
+    bool compact = false;
+
+    // Describes every setting, for result-cache keys.
+    std::string key() const;
+};
 
 class Obfuscator {
 private:
-    std::unordered_map<std::string, std::string> nameMap;
-    std::unordered_map<std::string, int> stringTable; 
-    std::vector<std::string> stringList;
+    // Atoms first referenced by one chunk of top-level statements, in the
+    // order a serial walk would meet them.
+    struct ChunkRefs {
+        std::vector<Atom> names;
+        std::vector<Atom> numbers;
+        std::vector<Atom> strings;
+        std::vector<Atom> members;
+    };
+
+    // A string-table lookup the generator will emit: a STRING node, or a
+    // MEMBER_EXPRESSION whose property goes through the table. Members are
+    // collected with INVALID_ATOM and get their index once every chunk has
+    // registered its members.
+    struct StringUse {
+        NodeId node;
+        Atom index;
+    };
+    // String indices decoded once into locals at the entry of scope, a
+    // function declaration or the program: cachedIndices[begin, end).
+    struct CachedStrings {
+        NodeId scope;
+        uint32_t begin;
+        uint32_t end;
+    };
+    // The string uses of one function, functionUses[begin, end).
+    struct ScopeUses {
+        NodeId scope;
+        uint32_t begin;
+        uint32_t end;
+    };
+    struct ChunkCache {
+        std::vector<StringUse> programUses;
+        std::vector<StringUse> functionUses;
+        std::vector<ScopeUses> functions;
+        std::vector<CachedStrings> scopes;
+        std::vector<Atom> indices;
+    };
+
+    // A name declared by a function, a parameter or a variable. Bindings of
+    // a nested function take slots after those of every enclosing one, so
+    // sibling functions share slots and nothing visible is ever shadowed;
+    // each slot then gets one name.
+    struct Binding {
+        uint32_t slot;
+        uint32_t uses;
+    };
+    // State of the NameStyle::SHORT pass. Only the scopes being walked are
+    // visible through bindingOf; leaving a scope restores what it shadowed.
+    struct ScopeWalk {
+        std::vector<uint32_t> bindingOf;                 // by atom: innermost binding
+        std::vector<std::pair<Atom, uint32_t>> shadowed;
+        std::vector<Binding> bindings;
+        std::vector<std::pair<NodeId, uint32_t>> refs;   // nodes to rename, by binding
+        std::vector<uint8_t> unbound;                    // by atom: read as a global
+        std::vector<uint8_t> declared;                   // by atom: renamed somewhere
+        uint32_t slotCount = 0;
+    };
+
+    AtomTable& atoms;
+    ThreadPool* pool;
+    ObfuscatorOptions options;
+    // Per-atom rewrite tables, indexed by atom id; INVALID_ATOM means unset.
+    std::vector<Atom> nameMap;
+    std::vector<Atom> numberMap;
+    std::vector<Atom> stringIndexMap;
+    std::vector<Atom> literalMap;  // raw string literal -> string-table index
+    std::vector<Atom> stringList;  // string values, as UTF-8, in index order
+    std::vector<bool> reservedNames;
     int nameCounter;
     int stringCounter;
-    std::unordered_set<std::string> reservedNames;
+    std::string stringFunc;
+    // String-table layout picked by generateStringTable for the decoder.
+    size_t shuffleStride = 1;
+    size_t shuffleOffset = 0;
+    std::array<uint8_t, 8> xorKey{};
+    std::vector<CachedStrings> cachedScopes;  // sorted by scope
+    std::vector<Atom> cachedIndices;
+    std::vector<uint8_t> readsCachedString;   // by node: emit the local, not a call
+    size_t scopedNames = 0;
+    std::vector<uint8_t> scopedSources;       // by atom: declared, so renamed
+    std::vector<Atom> scopedOriginals;        // by node: the name it had
+    // Set while generating with a source map: by the atom a node holds now
+    // with hex names, by its original atom with short ones.
+    std::vector<uint32_t> sourceNameIndex;    // index in the map's names
+
+    // Passes over the tree, run by a PassManager; see obfuscator.cc.
+    class RefCollector;
+    class Rewriter;
+    class MemberCollector;
+    class StringUseCollector;
+    class HoistedNames;
+    class ScopeResolver;
+    // The code generator is a pass over a layout, PrettyLayout or
+    // CompactLayout in obfuscator.cc, picked once per program.
+    template <class Layout>
+    class Generator;
 
     std::string generateNewName();
-    std::string getObfuscatedName(const std::string& original);
-    std::string getStringIndex(const std::string& str);
-    std::string obfuscateNumber(const std::string& num);
-    void obfuscateNode(std::shared_ptr<ASTNode> node);
-    std::string generateCode(std::shared_ptr<ASTNode> node, int indent = 0);
-    std::string generateStringTable(std::string& funcName);
+    bool isReserved(Atom name) const;
+    Atom getObfuscatedName(Atom original);
+    Atom getStringIndex(Atom clean);
+    Atom obfuscateNumber(Atom num);
+    std::vector<NodeId> splitProgram(const AST& ast) const;
+    void forEachChunk(size_t count, const std::function<void(size_t)>& fn);
+    bool isPlainMember(const AST& ast, NodeId member) const;
+    void renameScopes(AST& ast);
+    void declareBinding(ScopeWalk& walk, Atom name, uint32_t scopeBegin, uint32_t& nextSlot) const;
+    void useBinding(ScopeWalk& walk, NodeId node, Atom name) const;
+    void planStringCache(const AST& ast, std::vector<ChunkCache>& chunks);
+    void cacheRepeatedStrings(NodeId scope, const StringUse* begin, const StringUse* end,
+                              std::vector<CachedStrings>& scopes, std::vector<Atom>& indices,
+                              std::vector<uint32_t>& counts);
+    template <class Layout>
+    void generateCachedStrings(NodeId scope, int indent, std::string& out) const;
+    void generateStringLookup(Atom index, bool cached, std::string& out) const;
+    bool readsCached(NodeId node) const;
+    void collectSourceNames(SourceMap& map);
+    void mapNode(const AST& ast, NodeId node, bool named, std::string& out, MappingEncoder* map) const;
+    template <class Layout>
+    void generateProgram(const AST& ast, std::string& out, SourceMap* sourceMap);
+    void generateStringTable(std::string& out, std::string& funcName);
+    void appendStringDecoder(std::string& out, const std::string& tableName, const std::string& funcName);
 
 public:
-    Obfuscator();
-    void obfuscate(std::shared_ptr<ASTNode> ast);
-    std::string generateObfuscatedCode(std::shared_ptr<ASTNode> ast);
+    // New names and string-table indices are interned into atoms. With a
+    // pool of two or more threads, large programs are renamed and emitted
+    // in parallel, one chunk of top-level statements per task; the output
+    // is identical to a serial run.
+    Obfuscator(AtomTable& atoms, ThreadPool* pool = nullptr, const ObfuscatorOptions& options = {});
+    // Takes effect from the next obfuscate().
+    void setOptions(const ObfuscatorOptions& newOptions) { options = newOptions; }
+    const ObfuscatorOptions& getOptions() const { return options; }
+    void obfuscate(AST& ast);
+    std::string generateObfuscatedCode(const AST& ast);
+    // Replaces out's contents, reusing its capacity. With a source map
+    // whose lines hold the parsed source, also fills its names and mappings
+    // and ends the code with its sourceMappingURL comment, if it has a url.
+    void generateObfuscatedCode(const AST& ast, std::string& out, SourceMap* sourceMap = nullptr);
+    // Forgets every name and string handed out so the obfuscator can take
+    // the next input from a reset atom table. Table capacity is kept.
+    void reset();
+
+    // Names handed out so far; code generation adds two for the string table.
+    // With NameStyle::SHORT every binding counts, though siblings share names.
+    size_t renamedCount() const { return static_cast<size_t>(nameCounter) + scopedNames; }
+    size_t stringTableSize() const { return stringList.size(); }
 };
 
 #endif
\ No newline at end of file
@@ -7,70 +7,114 @@
 #ifndef PARSER_H
 #define PARSER_H
 
-#include <vector>
-#include <string>
+#include <cstdint>
 #include <memory>
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include "ast.h"
 #include "lexer.h"
-
-enum class ASTNodeType {
-    PROGRAM,
-    FUNCTION_DECLARATION,
-    BLOCK,
-    RETURN_STATEMENT,
-    VARIABLE_DECLARATION,
-    FUNCTION_CALL,
-    MEMBER_EXPRESSION,
-    EXPRESSION,
-    IDENTIFIER,
-    NUMBER,
-    STRING,
-    KEYWORD,
-    IF_STATEMENT,
-    WHILE_STATEMENT,
-    FOR_LOOP,
-    WHILE_LOOP,
-    BINARY_EXPRESSION
-};
-
-struct ASTNode {
-    ASTNodeType type;
-    std::string value;
-    std::vector<std::shared_ptr<ASTNode>> children;
-
-    ASTNode(ASTNodeType type, const std::string& value) : type(type), value(value) {}
-};
+#include "stats.h"
 
 class Parser {
 public:
-    Parser(const std::vector<Token>& tokens);
-    std::shared_ptr<ASTNode> parseProgram();
+    // Pulls tokens from source as it goes, so no token vector is ever
+    // materialized; source must outlive the parser. Nodes are appended to
+    // ast, which must outlive the parser's results.
+    Parser(TokenSource& source, AST& ast);
+    // Parses an already tokenized stream; pass an rvalue to avoid a copy.
+    Parser(TokenStream tokens, AST& ast);
+    NodeId parseProgram();
+#if CURSIOBFUSCATOR_STATS
+    const ParserStats& statistics() const { return stats; }
+#endif
 
 private:
-    std::vector<Token> tokens;
-    size_t currentIndex;
+    Parser(std::unique_ptr<TokenSource> owned, AST& ast);
+    Parser(TokenSource& source, std::unique_ptr<TokenSource>&& owned, AST& ast);
+
+    // An operator waiting for its right operand, or an open '(', call or
+    // '?' waiting for its closing token, while an expression is parsed.
+    struct PendingOp {
+        uint8_t kind;
+        uint8_t precedence;
+        Atom op;
+        NodeId left;    // left operand, condition or call node
+        NodeId middle;  // then-branch of a conditional
+        uint32_t offset;  // where a prefix operator starts
+    };
+
+    // A block being parsed as the body of owner, a statement of kind
+    // OpenKind; the block's statements are parsed before owner is done.
+    struct OpenBody {
+        NodeId owner;
+        NodeId block;
+        uint8_t kind;
+    };
+
+    // Pulled tokens not yet consumed live in a ring of kRingSize slots;
+    // head and tail count tokens from the start of the input. The grammar
+    // needs one token of lookahead, so the ring refills as soon as it runs
+    // empty. Once the source is exhausted, the slot at head holds an END
+    // sentinel, so the current token can always be read without a check.
+    static constexpr size_t kRingSize = 512;
+    static constexpr size_t kRingMask = kRingSize - 1;
+
+    std::unique_ptr<TokenSource> ownedSource;
+    TokenSource& source;
+    std::string_view text;
+    std::vector<TokenType> ringTypes;
+    std::vector<Atom> ringAtoms;
+    std::vector<uint32_t> ringOffsets;
+    std::vector<uint32_t> ringLengths;
+    size_t head = 0;
+    size_t tail = 0;
+    AST& ast;
+    // Explicit expression stack, kept across expressions for its capacity.
+    std::vector<PendingOp> pending;
+    // Explicit statement stack: the blocks open around the current statement.
+    std::vector<OpenBody> bodies;
+    OBF_STAT(ParserStats stats;)
+
+    // Stream for a diagnostic; counts it as an error-recovery event.
+    std::ostream& error();
+    // Drops the current token after a statement or primary failed to parse.
+    void skipToken();
 
-    bool isAtEnd() const;
-    const Token& peek() const;
+    // Pulls the next batch into the empty ring, or places the END sentinel.
+    void refill();
+    TokenType currentType() const { return ringTypes[head & kRingMask]; }
+    Atom currentAtom() const { return ringAtoms[head & kRingMask]; }
+    uint32_t currentOffset() const { return ringOffsets[head & kRingMask]; }
+    bool isAtEnd() const { return currentType() == TokenType::END; }
+    Token peek() const;
     void advance();
-    bool matchToken(const std::string& val);
+    bool matchToken(Atom val);
     bool matchTokenType(TokenType type);
 
-    std::shared_ptr<ASTNode> parseStatement();
-    std::shared_ptr<ASTNode> parseFunctionDeclaration();
-    std::shared_ptr<ASTNode> parseBlock();
-    std::shared_ptr<ASTNode> parseIfStatement();
-    std::shared_ptr<ASTNode> parseWhileStatement();
-    std::shared_ptr<ASTNode> parseVariableDeclaration();
-    std::shared_ptr<ASTNode> parseFunctionCall(std::shared_ptr<ASTNode> callee);
-    std::shared_ptr<ASTNode> parseReturnStatement();
-    std::shared_ptr<ASTNode> parseExpression();
-    std::shared_ptr<ASTNode> parseTerm();
-    std::shared_ptr<ASTNode> parseFactor();
-    std::shared_ptr<ASTNode> parseMemberExpression();
-    std::shared_ptr<ASTNode> parsePrimary();
-    std::shared_ptr<ASTNode> parseForLoop();
-    std::shared_ptr<ASTNode> parseWhileLoop();
-    std::shared_ptr<ASTNode> parseString();
+    NodeId parseStatement();
+    NodeId parseBlock();
+    // The statement at the current token, or kOpenedBody when it continues
+    // in a block that was pushed onto bodies.
+    NodeId beginStatement();
+    NodeId parseFunctionDeclaration();
+    NodeId parseIfStatement();
+    NodeId parseWhileStatement();
+    NodeId openBody(NodeId owner, uint8_t kind);
+    NodeId finishBody(const OpenBody& body);
+    NodeId completeStatement(size_t base, NodeId statement);
+    NodeId parseVariableDeclaration();
+    NodeId parseReturnStatement();
+    // sequence false stops at a comma outside parentheses, where it
+    // separates declarations instead.
+    NodeId parseExpression(bool sequence = true);
+    bool startsSequence(size_t base, bool sequence) const;
+    NodeId applyPending(const PendingOp& entry, NodeId operand);
+    NodeId reduceOperators(size_t base, NodeId operand, uint8_t precedence, bool rightAssoc);
+    NodeId unwindExpression(size_t base, NodeId operand);
+    NodeId parseForLoop();
+    NodeId parseWhileLoop();
+    NodeId parseString();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,160 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 21:10:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 21:10:00 
+ */
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "ast.h"
+
+// A set of node types, one bit per ASTNodeType.
+using NodeTypeMask = uint32_t;
+
+constexpr NodeTypeMask nodeTypeBit(ASTNodeType type) {
+    return NodeTypeMask(1) << static_cast<unsigned>(type);
+}
+
+template <class... Types>
+constexpr NodeTypeMask nodeTypes(Types... types) {
+    return (NodeTypeMask(0) | ... | nodeTypeBit(types));
+}
+
+constexpr NodeTypeMask kAllNodeTypes = ~NodeTypeMask(0);
+static_assert(static_cast<unsigned>(ASTNodeType::EMPTY) < 32, "node types must fit a NodeTypeMask");
+
+// Runs several passes over a tree in one preorder walk, so each node is
+// loaded once however many passes look at it. The walk keeps its own
+// stack instead of recursing, so nesting depth is bounded by memory rather
+// than by the C++ stack.
+//
+// A pass is a class with:
+//
+//   static constexpr NodeTypeMask kVisits;    // node types it is called for
+//   bool enter(NodeId node, NodeId parent);   // before the children
+//   void leave(NodeId node, NodeId parent);   // after them
+//
+// enter returns whether the pass wants to see node's subtree; children are
+// skipped once no pass wants them. leave is called for every node enter
+// was called for, whatever it returned. Nodes of other types are neither
+// entered nor left, and their subtrees are walked. parent is INVALID_NODE
+// for the root of a walk. Passes are called in the order given, so on each
+// node a pass sees what earlier ones did to it.
+//
+// Only passes that need nothing from a later node of another pass can
+// share a walk: one whose tables are merged over the whole program, like
+// the obfuscator's reference collection, must finish before the pass that
+// reads them starts.
+template <class... Passes>
+class PassManager {
+public:
+    static_assert(sizeof...(Passes) <= 32, "pass masks hold 32 passes");
+
+    explicit PassManager(Passes&... passes) : passes(passes...) {}
+
+    // Walks the subtree at root.
+    void run(const AST& ast, NodeId root) {
+        if (root != INVALID_NODE) walk(ast, root, INVALID_NODE);
+    }
+
+    // Walks the siblings [first, end) of parent's children and their
+    // subtrees, with parent passed to them but not entered.
+    void run(const AST& ast, NodeId parent, NodeId first, NodeId end) {
+        for (NodeId node = first; node != end; node = ast[node].nextSibling) walk(ast, node, parent);
+    }
+
+private:
+    static constexpr uint32_t kAllPasses = static_cast<uint32_t>((uint64_t(1) << sizeof...(Passes)) - 1);
+
+    // next is the child to enter next, or INVALID_NODE once none is left.
+    // entered holds the passes whose enter saw the node; active those that
+    // still want its subtree.
+    struct Frame {
+        NodeId node;
+        NodeId next;
+        uint32_t entered;
+        uint32_t active;
+    };
+
+    // The frame of the node being walked stays out of the stack, which
+    // holds only its ancestors.
+    void walk(const AST& ast, NodeId root, NodeId parent) {
+        stack.clear();
+        Frame top;
+        if (!visit(ast, root, parent, kAllPasses, top)) return;
+        for (;;) {
+            if (top.next != INVALID_NODE) {
+                NodeId child = top.next;
+                top.next = ast[child].nextSibling;
+                Frame inner;
+                if (visit(ast, child, top.node, top.active, inner)) {
+                    stack.push_back(top);
+                    top = inner;
+                }
+                continue;
+            }
+            Frame done = top;
+            bool last = stack.empty();
+            if (!last) {
+                top = stack.back();
+                stack.pop_back();
+            }
+            leave(ast[done.node].type, done.node, last ? parent : top.node, done.entered,
+                  std::index_sequence_for<Passes...>());
+            if (last) return;
+        }
+    }
+
+    // Enters node and returns whether it has children to walk, with frame
+    // set up for them; otherwise leaves it at once. Most nodes are leaves
+    // and never touch the stack.
+    bool visit(const AST& ast, NodeId node, NodeId parent, uint32_t entered, Frame& frame) {
+        const ASTNode& current = ast[node];
+        uint32_t active = enter(current.type, node, parent, entered, std::index_sequence_for<Passes...>());
+        if (active != 0 && current.firstChild != INVALID_NODE) {
+            frame = { node, current.firstChild, entered, active };
+            return true;
+        }
+        leave(current.type, node, parent, entered, std::index_sequence_for<Passes...>());
+        return false;
+    }
+
+    template <size_t... I>
+    uint32_t enter(ASTNodeType type, NodeId node, NodeId parent, uint32_t entered, std::index_sequence<I...>) {
+        uint32_t active = 0;
+        ((active |= enterOne<I>(type, node, parent, entered)), ...);
+        return active;
+    }
+
+    template <size_t I>
+    uint32_t enterOne(ASTNodeType type, NodeId node, NodeId parent, uint32_t entered) {
+        using Pass = std::tuple_element_t<I, std::tuple<Passes...>>;
+        constexpr uint32_t bit = uint32_t(1) << I;
+        if (!(entered & bit)) return 0;
+        if (!(Pass::kVisits & nodeTypeBit(type))) return bit;
+        return std::get<I>(passes).enter(node, parent) ? bit : 0;
+    }
+
+    template <size_t... I>
+    void leave(ASTNodeType type, NodeId node, NodeId parent, uint32_t entered, std::index_sequence<I...>) {
+        (leaveOne<I>(type, node, parent, entered), ...);
+    }
+
+    template <size_t I>
+    void leaveOne(ASTNodeType type, NodeId node, NodeId parent, uint32_t entered) {
+        using Pass = std::tuple_element_t<I, std::tuple<Passes...>>;
+        if ((entered & (uint32_t(1) << I)) && (Pass::kVisits & nodeTypeBit(type))) {
+            std::get<I>(passes).leave(node, parent);
+        }
+    }
+
+    std::tuple<Passes&...> passes;
+    std::vector<Frame> stack;
+};
+
+#endif
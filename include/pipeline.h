@@ -0,0 +1,84 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 13:40:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 13:40:00 
+ */
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "ast.h"
+#include "atom_table.h"
+#include "obfuscator.h"
+
+class ThreadPool;
+struct ASTFileSource;
+struct RunStats;
+class SourceLines;
+struct SourceMap;
+
+// Called with the obfuscated AST before code is generated from it.
+using AstInspector = std::function<void(const AST& ast, const AtomTable& atoms)>;
+
+// Reusable lexer -> parser -> obfuscator -> codegen pipeline. The parser
+// pulls tokens from the lexer as it needs them, so no token vector is built;
+// with a pool of two or more threads, inputs of 1 MiB and up are lexed on a
+// thread of their own while they are parsed. Each context owns all of its
+// state, so separate contexts can run on separate threads; one context must
+// not be used by two threads at once. Atom, node and output storage is kept
+// between runs, so a context that handles many inputs stops allocating once
+// it has seen the largest one.
+class ObfuscationContext {
+public:
+    // pool may be null; it must outlive the context.
+    explicit ObfuscationContext(ThreadPool* pool = nullptr, const ObfuscatorOptions& options = {});
+    ObfuscationContext(const ObfuscationContext&) = delete;
+    ObfuscationContext& operator=(const ObfuscationContext&) = delete;
+
+    // Obfuscates source and returns the generated code, which stays valid
+    // until the next run() or reset(). In builds with statistics, a non-null
+    // stats accumulates phase timings and counters. A non-null sourceMap is
+    // filled in while the code is generated. Lexer and parser exceptions
+    // propagate, and the next run starts clean regardless.
+    const std::string& run(std::string_view source, const AstInspector& inspect = nullptr,
+                           RunStats* stats = nullptr, SourceMap* sourceMap = nullptr);
+
+    // run() in steps, so the parsed tree can be saved, or loaded instead of
+    // parsed. parse() and load() drop the previous input; obfuscate() then
+    // takes the tree the same way run() does, except that a non-null
+    // sourceMap's lines must already be set: parse() fills a non-null lines
+    // with the line starts the lexer records as it goes.
+    void parse(std::string_view source, RunStats* stats = nullptr, SourceLines* lines = nullptr);
+    // Loads an AST file (see ast_file.h) in place of parsing. Returns false
+    // with error set when data is not one.
+    bool load(std::string_view data, ASTFileSource& source, std::string& error, RunStats* stats = nullptr);
+    // Writes the tree parse() just built from source as an AST file.
+    void save(std::string_view source, std::string_view sourcePath, std::string& out) const;
+    const std::string& obfuscate(const AstInspector& inspect = nullptr, RunStats* stats = nullptr,
+                                 SourceMap* sourceMap = nullptr);
+
+    // Moves the last result out; the next run starts a new output buffer.
+    std::string takeOutput() { return std::move(output); }
+    // Drops the previous input, keeping allocated capacity.
+    void reset();
+    // Applies to every later run().
+    void setOptions(const ObfuscatorOptions& options) { obfuscator.setOptions(options); }
+
+private:
+    ThreadPool* pool;
+    AtomTable atoms;
+    AST ast;
+    Obfuscator obfuscator;
+    std::string output;
+};
+
+// One-shot convenience wrapper around ObfuscationContext::run.
+std::string obfuscateSource(std::string_view source, ThreadPool* pool = nullptr,
+                            const AstInspector& inspect = nullptr, RunStats* stats = nullptr,
+                            const ObfuscatorOptions& options = {}, SourceMap* sourceMap = nullptr);
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 12:30:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 12:30:00 
+ */
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+class InputFile;
+
+// On-disk cache of generated code, keyed by a 128-bit hash of the input
+// bytes, the cache format version and the options that affect output.
+// Entries are written to a temporary file and renamed into place, so
+// several processes can share one directory. Hits refresh the entry's
+// modification time; evict() removes the least recently used entries once
+// the directory grows past its size limit. A running total kept in the
+// directory lets evict() skip the scan while the cache is under the limit.
+//
+// lookup(), store() and evict() may be called from several threads at once.
+class ResultCache {
+public:
+    // options describes every setting that changes the generated code.
+    ResultCache(const std::string& dir, uintmax_t maxBytes, const std::string& options);
+
+    std::string key(std::string_view input) const;
+    // Maps the cached output for key into out. Returns false on a miss.
+    bool lookup(const std::string& key, InputFile& out) const;
+    // Best effort: a failed store only costs a future miss. Returns true
+    // once the entries stored since the last evict() may have taken the
+    // cache past its size limit, so a long-running caller knows to evict().
+    bool store(const std::string& key, std::string_view output);
+    void evict();
+
+    static constexpr uintmax_t kDefaultMaxBytes = uintmax_t(512) << 20;
+
+private:
+    std::string entryPath(const std::string& key) const;
+    std::string tempPath(const std::string& name);
+    void writeSize(uintmax_t size);
+
+    std::string dir;
+    uintmax_t maxBytes;
+    uint64_t seed;
+    std::atomic<unsigned> tempCounter{0};
+    // Bytes stored since the last evict().
+    std::atomic<uintmax_t> storedBytes{0};
+    // The running total as of the last evict(), or the limit when there is
+    // none yet, so the first store asks for a scan.
+    std::atomic<uintmax_t> trackedBytes;
+    // One evict() at a time; a second caller then finds nothing stored.
+    std::mutex evictMutex;
+};
+
+#endif
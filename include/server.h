@@ -0,0 +1,55 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 14:50:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 14:50:00 
+ */
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "obfuscator.h"
+
+class ResultCache;
+
+// Wire format on the Unix domain socket. A client sends any number of
+// requests on one connection and reads one response per request, in order:
+//
+//   request:  u64 length, then that many bytes of JavaScript
+//   response: u8 status (kStatusOk or kStatusError), u64 length, then the
+//             generated code or an error message
+//
+// Lengths are little-endian. Closing the connection ends the session.
+constexpr unsigned char kStatusOk = 0;
+constexpr unsigned char kStatusError = 1;
+
+// Larger requests are answered with an error and the connection is closed.
+constexpr uint64_t kDefaultMaxRequestBytes = uint64_t(256) << 20;
+
+struct ServerOptions {
+    std::string socketPath;
+    // Requests served at once; 0 uses one thread per core.
+    size_t threads = 0;
+    // Applied to every request.
+    ObfuscatorOptions obfuscator;
+    // Request size limit. Buffers grow as a request's bytes arrive, so a
+    // client cannot make the server allocate more than it sends.
+    uint64_t maxRequestBytes = kDefaultMaxRequestBytes;
+    // Optional; shared by every connection. Its key must cover obfuscator.
+    ResultCache* cache = nullptr;
+};
+
+// Listens on options.socketPath until SIGINT or SIGTERM. Idle connections
+// wait in one poll loop, and each request runs on a pool worker that keeps
+// its pipeline context, and so its arenas and tables, warm across requests.
+// Returns the process exit code.
+int runServer(const ServerOptions& options);
+
+// Sends source to the server at socketPath and stores the generated code in
+// output. Prints a message and returns false on failure.
+bool requestObfuscation(const std::string& socketPath, std::string_view source, std::string& output);
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 18:20:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 18:20:00 
+ */
+#ifndef SOURCE_MAP_H
+#define SOURCE_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Index of a segment's entry in the map's names, or none.
+constexpr uint32_t kNoSourceName = UINT32_MAX;
+
+// Turns byte offsets in one source text into zero-based lines and columns.
+// Columns count bytes, which matches UTF-16 units for ASCII sources.
+class SourceLines {
+public:
+    // Takes the offset of each line of the text, in order and starting with
+    // 0: the ones the lexer recorded, the ones saved in an AST file, or
+    // scan()'s.
+    void reset(std::vector<uint32_t> starts);
+    // Byte offset of each line of text, starting with 0.
+    static std::vector<uint32_t> scan(std::string_view text);
+    // Searches outward from line hint, such as the previous lookup's line:
+    // code generated in source order seldom moves far from it.
+    void locate(uint32_t offset, uint32_t hint, uint32_t& line, uint32_t& column) const;
+
+private:
+    // Followed by UINT32_MAX, which no offset reaches, so the line after
+    // the last one can be read without a bounds check.
+    std::vector<uint32_t> lineStarts;
+    uint32_t count = 0;
+};
+
+// Encodes the base64-VLQ "mappings" of a v3 source map while the code it
+// describes is being generated. add() only queues a segment; a full batch
+// is encoded at once against the code written so far, which keeps the
+// generator's loop short and lets each search for a line break in the code
+// run to the next one instead of stopping at the next segment. Source lines
+// are searched from the previous segment's, so the whole cost is linear in
+// the code size.
+//
+// Code generated separately, such as one chunk of a parallel run, gets an
+// encoder of its own and is spliced in with append(). Segment fields are
+// deltas from the previous segment, so only the chunk's first segment and
+// its first named segment are re-encoded; the rest is copied as is.
+class MappingEncoder {
+public:
+    // lines must outlive the encoder's use; null turns add() into a no-op.
+    void reset(const SourceLines* lines);
+
+    // Maps the end of code, where the caller is about to emit the text that
+    // came from sourceOffset. Calls must follow the code as it grows; a
+    // second segment at the same position is dropped, and so is an offset
+    // of UINT32_MAX (kNoSourceOffset).
+    void add(const std::string& code, uint32_t sourceOffset, uint32_t name = kNoSourceName) {
+        if (!lines || sourceOffset == UINT32_MAX) return;
+        queued.push_back({ code.size(), sourceOffset, name });
+        if (queued.size() == kBatchSegments) flush(code);
+    }
+    // Accounts for every line of code up to its end. text() is complete
+    // once this has been called.
+    void finish(const std::string& code);
+    // Splices in the segments of a chunk that was appended to code at
+    // chunkStart, which may fall mid-line. chunk must have been finished, and
+    // this encoder cannot itself be appended elsewhere afterwards.
+    void append(const std::string& code, const MappingEncoder& chunk, size_t chunkStart);
+
+    const std::string& text() const { return mappings; }
+
+private:
+    static constexpr size_t kBatchSegments = 4096;
+
+    struct Queued {
+        size_t position;
+        uint32_t sourceOffset;
+        uint32_t name;
+    };
+
+    // A segment as written, kept so append() can rebase it.
+    struct Segment {
+        size_t begin = 0;
+        size_t end = 0;
+        int64_t columnDelta = 0;
+        int64_t lineDelta = 0;
+        int64_t sourceColumnDelta = 0;
+        int64_t sourceLine = 0;
+        int64_t sourceColumn = 0;
+        int64_t name = -1;  // absolute, or -1 when unnamed
+    };
+
+    // Room for bytes more characters of mappings, which are written past
+    // used and then kept by setting used to the end of what was written.
+    char* reserve(size_t bytes);
+    // Encodes the queued segments; code must hold all of their positions.
+    void flush(const std::string& code);
+    void encode(const std::string& code, const Queued& segment);
+    void advance(const std::string& code, size_t position);
+    char* writeSegment(char* out, int64_t column, int64_t line, int64_t sourceColumn, int64_t name);
+
+    const SourceLines* lines = nullptr;
+    std::vector<Queued> queued;
+    // Grown ahead of what is written; trimmed to used by finish().
+    std::string mappings;
+    size_t used = 0;
+    // Bytes of code whose line breaks are in mappings or nextBreak, and the
+    // first line break not in mappings yet, or SIZE_MAX until it is found.
+    size_t searched = 0;
+    size_t nextBreak = SIZE_MAX;
+    size_t lineStart = 0;  // where the current generated line starts
+    bool lineHasSegment = false;
+    // Values of the previous segment, which the next one is relative to.
+    int64_t column = 0;
+    int64_t sourceLine = 0;
+    int64_t sourceColumn = 0;
+    int64_t name = 0;
+    bool hasSegment = false;
+    bool hasNamed = false;
+    Segment first;
+    Segment firstNamed;
+};
+
+// A v3 source map for one generated file with one source.
+struct SourceMap {
+    std::string file;    // the generated file, as the map names it
+    std::string source;  // the original file, relative to the map
+    std::string url;     // sourceMappingURL comment; empty writes none
+    SourceLines lines;
+    MappingEncoder mappings;
+    // Original identifier spellings, which segments refer to by index.
+    std::vector<std::string> names;
+
+    // Names the map after the output it describes: outputPath + ".map",
+    // pointing back at inputPath.
+    void setPaths(const std::string& inputPath, const std::string& outputPath);
+    std::string toJson() const;
+};
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 13:40:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 13:40:00 
+ */
+#ifndef STATS_H
+#define STATS_H
+
+// Run statistics for --stats. Configure with -DCURSIOBFUSCATOR_STATS=OFF to
+// compile every counter, timer and report out of the build.
+#ifndef CURSIOBFUSCATOR_STATS
+#define CURSIOBFUSCATOR_STATS 1
+#endif
+
+#if CURSIOBFUSCATOR_STATS
+// Expands its argument only in builds with statistics enabled.
+#define OBF_STAT(...) __VA_ARGS__
+#else
+#define OBF_STAT(...)
+#endif
+
+#if CURSIOBFUSCATOR_STATS
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <ostream>
+
+class AST;
+
+constexpr size_t kTokenTypeCount = 6;
+constexpr size_t kNodeTypeCount = 21;
+
+enum StatPhase {
+    PHASE_READ,
+    PHASE_TOKENIZE,
+    PHASE_PARSE,
+    PHASE_OBFUSCATE,
+    PHASE_DUMP,
+    PHASE_GENERATE,
+    PHASE_WRITE,
+    PHASE_COUNT
+};
+
+struct LexerStats {
+    uint64_t tokens[kTokenTypeCount] = {};
+    uint64_t unknownTokens = 0;
+    uint64_t whitespaceRuns = 0;  // runs long enough for the vector kernel
+};
+
+struct ParserStats {
+    uint64_t errors = 0;         // diagnostics printed
+    uint64_t skippedTokens = 0;  // tokens dropped to resynchronize
+};
+
+struct RunStats {
+    double wallMs[PHASE_COUNT] = {};
+    double cpuMs[PHASE_COUNT] = {};
+    double totalWallMs = 0;
+    double totalCpuMs = 0;
+    // Batch runs time phases on several threads at once, where process
+    // CPU time per phase means nothing; only totals carry CPU time then.
+    bool phaseCpu = true;
+
+    uint64_t files = 0;
+    uint64_t cacheHits = 0;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t tokens[kTokenTypeCount] = {};
+    uint64_t nodes[kNodeTypeCount] = {};
+    uint64_t atoms = 0;
+    uint64_t renamedNames = 0;
+    uint64_t foldedExpressions = 0;
+    uint64_t stringTableEntries = 0;
+    LexerStats lexer;
+    ParserStats parser;
+
+    void countNodes(const AST& ast);
+    void merge(const RunStats& other);
+
+    // Bracket a whole run to fill totalWallMs and totalCpuMs.
+    void startTotal();
+    void stopTotal();
+
+private:
+    std::chrono::steady_clock::time_point totalWallStart;
+    std::clock_t totalCpuStart = 0;
+};
+
+// Adds the wall and process CPU time of its scope to one phase. A null
+// stats pointer makes it a no-op.
+class PhaseTimer {
+public:
+    PhaseTimer(RunStats* stats, StatPhase phase);
+    ~PhaseTimer();
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    RunStats* stats;
+    StatPhase phase;
+    std::chrono::steady_clock::time_point wallStart;
+    std::clock_t cpuStart;
+};
+
+void printStats(std::ostream& out, const RunStats& stats, bool json);
+
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 11:05:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 11:05:00 
+ */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size work-stealing thread pool. Every worker owns a deque: it takes
+// its own work from the back (most recently pushed, still cache-warm) and,
+// when that runs dry, steals from the front of the other workers' deques.
+// Tasks submitted from inside a worker go to that worker's deque; tasks
+// submitted from outside are spread round-robin.
+//
+// Tasks must not throw; catch and report errors inside the task.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // threadCount == 0 uses std::thread::hardware_concurrency().
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Task task);
+    // Blocks until every submitted task has finished. Must not be called
+    // from a worker thread.
+    void wait();
+    size_t size() const { return workers.size(); }
+
+    static size_t defaultThreadCount();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool popLocal(size_t index, Task& task);
+    bool steal(size_t index, Task& task);
+    void workerLoop(size_t index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    std::atomic<size_t> queued{0};  // tasks sitting in some deque
+    size_t pending = 0;             // tasks submitted but not yet finished
+    bool stopping = false;
+    std::atomic<size_t> nextQueue{0};
+};
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 10:15:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 10:15:00 
+ */
+#include "arena.h"
+#include <cstring>
+
+std::string_view StringArena::store(std::string_view text) {
+    if (text.empty()) return {};
+    if (text.size() > remaining) {
+        // Oversized strings get a dedicated block so the current one keeps its tail.
+        if (text.size() > kBlockSize / 4) {
+            oversized.emplace_back(new char[text.size()]);
+            allocated += text.size();
+            std::memcpy(oversized.back().get(), text.data(), text.size());
+            return std::string_view(oversized.back().get(), text.size());
+        }
+        if (nextBlock == blocks.size()) {
+            blocks.emplace_back(new char[kBlockSize]);
+            allocated += kBlockSize;
+        }
+        cursor = blocks[nextBlock++].get();
+        remaining = kBlockSize;
+    }
+    std::memcpy(cursor, text.data(), text.size());
+    std::string_view stored(cursor, text.size());
+    cursor += text.size();
+    remaining -= text.size();
+    return stored;
+}
+
+void StringArena::clear() {
+    blocks.clear();
+    oversized.clear();
+    nextBlock = 0;
+    cursor = nullptr;
+    remaining = 0;
+    allocated = 0;
+}
+
+void StringArena::reset() {
+    oversized.clear();
+    nextBlock = 0;
+    cursor = nullptr;
+    remaining = 0;
+    allocated = blocks.size() * kBlockSize;
+}
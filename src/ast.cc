@@ -0,0 +1,80 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 10:15:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 10:15:00 
+ */
+#include "ast.h"
+#include <array>
+
+namespace {
+
+// Every operator the lexer produces is a well-known atom, so the table only
+// spans those.
+constexpr std::array<uint8_t, ATOM_WELL_KNOWN_COUNT> makeBinaryPrecedence() {
+    std::array<uint8_t, ATOM_WELL_KNOWN_COUNT> table{};
+    table[ATOM_COMMA] = PREC_SEQUENCE;
+    for (Atom op : { ATOM_ASSIGN, ATOM_SHL_ASSIGN, ATOM_SHR_ASSIGN, ATOM_USHR_ASSIGN, ATOM_PLUS_ASSIGN,
+                     ATOM_MINUS_ASSIGN, ATOM_STAR_ASSIGN, ATOM_SLASH_ASSIGN, ATOM_PERCENT_ASSIGN,
+                     ATOM_BIT_AND_ASSIGN, ATOM_BIT_OR_ASSIGN, ATOM_BIT_XOR_ASSIGN }) {
+        table[op] = PREC_ASSIGN;
+    }
+    table[ATOM_OR] = PREC_OR;
+    table[ATOM_AND] = PREC_AND;
+    table[ATOM_BIT_OR] = PREC_BIT_OR;
+    table[ATOM_BIT_XOR] = PREC_BIT_XOR;
+    table[ATOM_BIT_AND] = PREC_BIT_AND;
+    for (Atom op : { ATOM_EQ, ATOM_STRICT_EQ, ATOM_NE, ATOM_STRICT_NE }) table[op] = PREC_EQUALITY;
+    for (Atom op : { ATOM_LT, ATOM_LE, ATOM_GT, ATOM_GE }) table[op] = PREC_RELATIONAL;
+    for (Atom op : { ATOM_SHL, ATOM_SHR, ATOM_USHR }) table[op] = PREC_SHIFT;
+    for (Atom op : { ATOM_PLUS, ATOM_MINUS }) table[op] = PREC_ADDITIVE;
+    for (Atom op : { ATOM_STAR, ATOM_SLASH, ATOM_PERCENT }) table[op] = PREC_MULTIPLICATIVE;
+    return table;
+}
+
+constexpr auto kBinaryPrecedence = makeBinaryPrecedence();
+
+} // namespace
+
+uint8_t binaryPrecedence(Atom op) {
+    if (op >= kBinaryPrecedence.size()) return PREC_NONE;
+    return kBinaryPrecedence[op];
+}
+
+bool isPrefixOperator(Atom op) {
+    return op == ATOM_NOT || op == ATOM_BIT_NOT || op == ATOM_PLUS || op == ATOM_MINUS ||
+           op == ATOM_INCREMENT || op == ATOM_DECREMENT;
+}
+
+NodeId AST::addNode(ASTNodeType type, Atom value, uint32_t sourceOffset) {
+    ASTNode node;
+    node.type = type;
+    node.value = value;
+    nodes.push_back(node);
+    offsets.push_back(sourceOffset);
+    return static_cast<NodeId>(nodes.size() - 1);
+}
+
+void AST::appendChild(NodeId parent, NodeId child) {
+    if (child == INVALID_NODE) child = addNode(ASTNodeType::EMPTY, ATOM_EMPTY, kNoSourceOffset);
+    ASTNode& p = nodes[parent];
+    if (p.lastChild == INVALID_NODE) {
+        p.firstChild = child;
+    } else {
+        nodes[p.lastChild].nextSibling = child;
+    }
+    p.lastChild = child;
+    p.childCount++;
+}
+
+NodeId AST::child(NodeId parent, uint32_t index) const {
+    NodeId id = nodes[parent].firstChild;
+    while (index-- > 0 && id != INVALID_NODE) id = nodes[id].nextSibling;
+    return id;
+}
+
+void AST::clear() {
+    nodes.clear();
+    offsets.clear();
+    rootNode = INVALID_NODE;
+}
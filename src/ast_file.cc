@@ -0,0 +1,277 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 22:05:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 22:05:00 
+ */
+#include "ast_file.h"
+#include "lexer.h"
+#include "source_map.h"
+
+namespace {
+
+constexpr std::string_view kMagic = "CURSIAST";
+constexpr size_t kHeaderWords = 9;
+constexpr size_t kHeaderBytes = kMagic.size() + kHeaderWords * 4;
+constexpr size_t kNodeWords = 6;
+
+void putWord(std::string& out, uint32_t value) {
+    char bytes[4] = { static_cast<char>(value), static_cast<char>(value >> 8), static_cast<char>(value >> 16),
+                      static_cast<char>(value >> 24) };
+    out.append(bytes, 4);
+}
+
+// Spelled out so compilers read it as one load on little-endian hosts.
+uint32_t getWord(const char* in) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(in);
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+// Children the obfuscator expects at least; leaves must have none.
+uint32_t minChildren(ASTNodeType type) {
+    switch (type) {
+        case ASTNodeType::FUNCTION_DECLARATION:
+        case ASTNodeType::FUNCTION_CALL:
+        case ASTNodeType::UNARY_EXPRESSION:
+        case ASTNodeType::POSTFIX_EXPRESSION:
+            return 1;
+        case ASTNodeType::MEMBER_EXPRESSION:
+        case ASTNodeType::EXPRESSION:
+        case ASTNodeType::BINARY_EXPRESSION:
+            return 2;
+        case ASTNodeType::CONDITIONAL_EXPRESSION:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+bool isLeaf(ASTNodeType type) {
+    return type == ASTNodeType::IDENTIFIER || type == ASTNodeType::NUMBER || type == ASTNodeType::STRING ||
+           type == ASTNodeType::EMPTY;
+}
+
+// Whether value is an atom the parser gives nodes of this type.
+bool isOperatorFor(ASTNodeType type, Atom value) {
+    switch (type) {
+        case ASTNodeType::EXPRESSION:
+        case ASTNodeType::BINARY_EXPRESSION:
+            return binaryPrecedence(value) != PREC_NONE;
+        case ASTNodeType::UNARY_EXPRESSION:
+            return isPrefixOperator(value);
+        case ASTNodeType::POSTFIX_EXPRESSION:
+            return value == ATOM_INCREMENT || value == ATOM_DECREMENT;
+        case ASTNodeType::CONDITIONAL_EXPRESSION:
+            return value == ATOM_QUESTION;
+        case ASTNodeType::MEMBER_EXPRESSION:
+            return value == ATOM_DOT;
+        default:
+            return true;
+    }
+}
+
+// Token kind a node's atom must spell, or END when any atom will do.
+TokenType spelledAs(ASTNodeType type) {
+    switch (type) {
+        case ASTNodeType::IDENTIFIER:
+        case ASTNodeType::FUNCTION_DECLARATION:
+        case ASTNodeType::VARIABLE_DECLARATION:
+            return TokenType::IDENTIFIER;
+        case ASTNodeType::NUMBER:
+            return TokenType::NUMBER;
+        case ASTNodeType::STRING:
+            return TokenType::STRING;
+        default:
+            return TokenType::END;
+    }
+}
+
+// Lexes text on its own; END unless it is exactly one token.
+TokenType tokenTypeOf(std::string_view text, AtomTable& scratch) {
+    Lexer lexer(text, scratch);
+    TokenType types[2];
+    Atom atoms[2];
+    uint32_t offsets[2];
+    uint32_t lengths[2];
+    if (lexer.fill({ types, atoms, offsets, lengths }, 2) != 1 || offsets[0] != 0 || lengths[0] != text.size()) {
+        return TokenType::END;
+    }
+    return types[0];
+}
+
+bool fail(std::string& error, const char* message) {
+    error = message;
+    return false;
+}
+
+// Child lists must match their counts and last links, and each type must
+// have the children it needs. linked marks the root and the nodes some
+// other node links to.
+bool checkChildren(const AST& ast, const std::vector<uint8_t>& linked, std::string& error) {
+    for (NodeId id = 0; id < ast.size(); ++id) {
+        const ASTNode& node = ast[id];
+        uint32_t children = 0;
+        NodeId last = INVALID_NODE;
+        for (NodeId child = node.firstChild; child != INVALID_NODE; child = ast[child].nextSibling) {
+            if (children == node.childCount) return fail(error, "AST file child list longer than its count");
+            ++children;
+            last = child;
+        }
+        if (children != node.childCount || last != node.lastChild) {
+            return fail(error, "AST file child list does not match its count");
+        }
+        // The parser leaves functions it gave up on unlinked and without a body.
+        bool needsChildren = linked[id] || node.type != ASTNodeType::FUNCTION_DECLARATION;
+        if ((isLeaf(node.type) && children > 0) || (needsChildren && children < minChildren(node.type))) {
+            return fail(error, "AST file node has the wrong number of children");
+        }
+        // A member is its object and an identifier naming the property.
+        if (node.type == ASTNodeType::MEMBER_EXPRESSION &&
+            (children != 2 || ast[node.lastChild].type != ASTNodeType::IDENTIFIER)) {
+            return fail(error, "AST file member has the wrong children");
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void writeASTFile(const AST& ast, const AtomTable& atoms, std::string_view source, std::string_view sourcePath,
+                  std::string& out) {
+    std::vector<uint32_t> starts = SourceLines::scan(source);
+    size_t nodeCount = ast.size();
+    size_t atomCount = atoms.size() - ATOM_WELL_KNOWN_COUNT;
+    size_t textBytes = 0;
+    for (Atom atom = ATOM_WELL_KNOWN_COUNT; atom < atoms.size(); ++atom) textBytes += atoms.str(atom).size();
+
+    out.clear();
+    out.reserve(kHeaderBytes + (nodeCount * (kNodeWords + 1) + atomCount + starts.size()) * 4 + textBytes +
+                sourcePath.size());
+    out += kMagic;
+    putWord(out, kASTFileVersion);
+    putWord(out, ATOM_WELL_KNOWN_COUNT);
+    putWord(out, static_cast<uint32_t>(nodeCount));
+    putWord(out, ast.root());
+    putWord(out, static_cast<uint32_t>(atomCount));
+    putWord(out, static_cast<uint32_t>(textBytes));
+    putWord(out, static_cast<uint32_t>(starts.size()));
+    putWord(out, static_cast<uint32_t>(sourcePath.size()));
+    putWord(out, static_cast<uint32_t>(source.size()));
+    for (NodeId id = 0; id < nodeCount; ++id) {
+        const ASTNode& node = ast[id];
+        putWord(out, static_cast<uint32_t>(node.type));
+        putWord(out, node.value);
+        putWord(out, node.firstChild);
+        putWord(out, node.lastChild);
+        putWord(out, node.nextSibling);
+        putWord(out, node.childCount);
+    }
+    for (NodeId id = 0; id < nodeCount; ++id) putWord(out, ast.sourceOffset(id));
+    uint32_t end = 0;
+    for (Atom atom = ATOM_WELL_KNOWN_COUNT; atom < atoms.size(); ++atom) {
+        end += static_cast<uint32_t>(atoms.str(atom).size());
+        putWord(out, end);
+    }
+    for (uint32_t start : starts) putWord(out, start);
+    for (Atom atom = ATOM_WELL_KNOWN_COUNT; atom < atoms.size(); ++atom) out += atoms.str(atom);
+    out += sourcePath;
+}
+
+bool readASTFile(std::string_view data, AST& ast, AtomTable& atoms, ASTFileSource& source, std::string& error) {
+    if (data.size() < kHeaderBytes || data.substr(0, kMagic.size()) != kMagic) {
+        return fail(error, "not an AST file");
+    }
+    const char* header = data.data() + kMagic.size();
+    if (getWord(header) != kASTFileVersion || getWord(header + 4) != ATOM_WELL_KNOWN_COUNT) {
+        return fail(error, "AST file from another version");
+    }
+    uint64_t nodeCount = getWord(header + 8);
+    NodeId root = getWord(header + 12);
+    uint64_t atomCount = getWord(header + 16);
+    uint64_t textBytes = getWord(header + 20);
+    uint64_t lineCount = getWord(header + 24);
+    uint64_t pathBytes = getWord(header + 28);
+    uint32_t sourceBytes = getWord(header + 32);
+    uint64_t expected =
+        kHeaderBytes + (nodeCount * (kNodeWords + 1) + atomCount + lineCount) * 4 + textBytes + pathBytes;
+    if (data.size() != expected) return fail(error, "truncated AST file");
+    const char* nodes = data.data() + kHeaderBytes;
+    if (root != INVALID_NODE && root >= nodeCount) return fail(error, "AST file root out of range");
+    if (root != INVALID_NODE && getWord(nodes + root * kNodeWords * 4) != static_cast<uint32_t>(ASTNodeType::PROGRAM)) {
+        return fail(error, "AST file root is not a program");
+    }
+    if (lineCount == 0) return fail(error, "AST file without line starts");
+
+    const char* offsets = nodes + nodeCount * kNodeWords * 4;
+    const char* atomEnds = offsets + nodeCount * 4;
+    const char* lines = atomEnds + atomCount * 4;
+    const char* text = lines + lineCount * 4;
+
+    atoms.reset();
+    uint32_t begin = 0;
+    for (uint64_t i = 0; i < atomCount; ++i) {
+        uint32_t end = getWord(atomEnds + i * 4);
+        if (end < begin || end > textBytes) return fail(error, "AST file atom out of range");
+        // Each text was distinct when saved, so it gets back its old id.
+        if (atoms.intern(std::string_view(text + begin, end - begin)) != ATOM_WELL_KNOWN_COUNT + i) {
+            return fail(error, "AST file repeats an atom");
+        }
+        begin = end;
+    }
+
+    // Token kind of each atom's text, lexed the first time a node needs it;
+    // SYMBOL until then, which no node's atom may be.
+    std::vector<TokenType> kinds(atoms.size(), TokenType::SYMBOL);
+    AtomTable scratch;
+
+    // Every node is the child or next sibling of at most one other and the
+    // root of none, so walks from the root end.
+    std::vector<uint8_t> linked(nodeCount);
+    if (root != INVALID_NODE) linked[root] = 1;
+    ast.clear();
+    ast.reserve(nodeCount);
+    for (uint64_t i = 0; i < nodeCount; ++i) {
+        const char* in = nodes + i * kNodeWords * 4;
+        uint32_t type = getWord(in);
+        Atom value = getWord(in + 4);
+        uint32_t offset = getWord(offsets + i * 4);
+        if (type > static_cast<uint32_t>(ASTNodeType::EMPTY) || value >= atoms.size() ||
+            (offset > sourceBytes && offset != kNoSourceOffset)) {
+            return fail(error, "AST file node out of range");
+        }
+        ASTNodeType nodeType = static_cast<ASTNodeType>(type);
+        if (!isOperatorFor(nodeType, value)) return fail(error, "AST file node has the wrong operator");
+        TokenType spelling = spelledAs(nodeType);
+        if (spelling != TokenType::END) {
+            if (kinds[value] == TokenType::SYMBOL) kinds[value] = tokenTypeOf(atoms.str(value), scratch);
+            if (kinds[value] != spelling) return fail(error, "AST file node has the wrong kind of atom");
+        }
+        ASTNode& node = ast[ast.addNode(nodeType, value, offset)];
+        node.firstChild = getWord(in + 8);
+        node.lastChild = getWord(in + 12);
+        node.nextSibling = getWord(in + 16);
+        node.childCount = getWord(in + 20);
+        if (node.lastChild != INVALID_NODE && node.lastChild >= nodeCount) {
+            return fail(error, "AST file node out of range");
+        }
+        for (NodeId next : { node.firstChild, node.nextSibling }) {
+            if (next == INVALID_NODE) continue;
+            if (next >= nodeCount) return fail(error, "AST file node out of range");
+            if (linked[next]) return fail(error, "AST file links a node twice");
+            linked[next] = 1;
+        }
+    }
+    ast.setRoot(root);
+    if (!checkChildren(ast, linked, error)) return false;
+
+    source.lineStarts.resize(lineCount);
+    for (uint64_t i = 0; i < lineCount; ++i) {
+        source.lineStarts[i] = getWord(lines + i * 4);
+        if (i == 0 ? source.lineStarts[i] != 0 : source.lineStarts[i] < source.lineStarts[i - 1]) {
+            return fail(error, "AST file line starts out of order");
+        }
+        if (source.lineStarts[i] > sourceBytes) return fail(error, "AST file line starts past the source");
+    }
+    source.path.assign(text + textBytes, pathBytes);
+    return true;
+}
@@ -0,0 +1,121 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 11:05:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 11:05:00 
+ */
+#include "atom_table.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr std::string_view kWellKnown[] = {
+    "", "if", "else", "for", "while", "return", "function", "const", "let", "var",
+    "(", ")", "{", "}", ";", ",", ".", "+", "-", "*", "/", "=",
+    "program", "block", "console", "log",
+    "%", "==", "===", "!=", "!==", "<", "<=", ">", ">=", "<<", ">>", ">>>", "<<=", ">>=", ">>>=",
+    "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=",
+    "&", "|", "^", "~", "&&", "||", "!", "++", "--", "?", ":",
+    "async", "await", "class", "new", "this", "super"
+};
+static_assert(sizeof(kWellKnown) / sizeof(kWellKnown[0]) == ATOM_WELL_KNOWN_COUNT,
+              "kWellKnown must list every WellKnownAtom in order");
+
+constexpr size_t kInitialSlots = 1024;
+
+uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hashText(std::string_view text) {
+    const char* p = text.data();
+    size_t n = text.size();
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+    while (n >= 8) {
+        uint64_t k;
+        std::memcpy(&k, p, 8);
+        h = (h ^ mix(k)) * 0x100000001b3ULL;
+        p += 8;
+        n -= 8;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p, n);
+    return mix(h ^ tail);
+}
+
+} // namespace
+
+AtomTable::AtomTable() {
+    clear();
+}
+
+size_t AtomTable::probe(std::string_view text, uint64_t hash) const {
+    size_t mask = slots.size() - 1;
+    size_t i = static_cast<size_t>(hash) & mask;
+    while (slots[i] != INVALID_ATOM) {
+        Atom atom = slots[i];
+        if (hashes[atom] == hash && strings[atom] == text) break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+Atom AtomTable::find(std::string_view text) const {
+    return slots[probe(text, hashText(text))];
+}
+
+Atom AtomTable::intern(std::string_view text) {
+    if (text.size() == 1) {
+        Atom& cached = singleChar[static_cast<uint8_t>(text[0])];
+        if (cached != INVALID_ATOM) return cached;
+    }
+
+    uint64_t hash = hashText(text);
+    size_t slot = probe(text, hash);
+    if (slots[slot] != INVALID_ATOM) return slots[slot];
+
+    Atom atom = static_cast<Atom>(strings.size());
+    strings.push_back(arena.store(text));
+    hashes.push_back(hash);
+    slots[slot] = atom;
+    if (text.size() == 1) singleChar[static_cast<uint8_t>(text[0])] = atom;
+    if (strings.size() * 2 > slots.size()) grow();
+    return atom;
+}
+
+void AtomTable::grow() {
+    std::vector<Atom> old(slots.size() * 2, INVALID_ATOM);
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (Atom atom : old) {
+        if (atom == INVALID_ATOM) continue;
+        size_t i = static_cast<size_t>(hashes[atom]) & mask;
+        while (slots[i] != INVALID_ATOM) i = (i + 1) & mask;
+        slots[i] = atom;
+    }
+}
+
+void AtomTable::clear() {
+    strings.clear();
+    hashes.clear();
+    arena.clear();
+    slots.assign(kInitialSlots, INVALID_ATOM);
+    internWellKnown();
+}
+
+void AtomTable::reset() {
+    strings.clear();
+    hashes.clear();
+    arena.reset();
+    std::fill(slots.begin(), slots.end(), INVALID_ATOM);
+    internWellKnown();
+}
+
+void AtomTable::internWellKnown() {
+    singleChar.fill(INVALID_ATOM);
+    for (std::string_view text : kWellKnown) intern(text);
+}
@@ -0,0 +1,90 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 15:40:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 15:40:00 
+ */
+#include "background_lexer.h"
+#include <algorithm>
+
+BackgroundLexer::BackgroundLexer(TokenSource& tokens) : source(tokens) {
+    for (Batch& batch : batches) {
+        batch.types.resize(kBatchTokens);
+        batch.atoms.resize(kBatchTokens);
+        batch.offsets.resize(kBatchTokens);
+        batch.lengths.resize(kBatchTokens);
+    }
+    thread = std::thread(&BackgroundLexer::produce, this);
+}
+
+BackgroundLexer::~BackgroundLexer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    space.notify_one();
+    thread.join();
+}
+
+void BackgroundLexer::produce() {
+    try {
+        for (;;) {
+            Batch* batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                space.wait(lock, [this] { return stopping || produced - consumed < kBatchCount; });
+                if (stopping) return;
+                batch = &batches[produced % kBatchCount];
+            }
+            // The slot is unpublished, so it is filled without the lock.
+            TokenSlots slots = { batch->types.data(), batch->atoms.data(), batch->offsets.data(),
+                                 batch->lengths.data() };
+            batch->count = source.fill(slots, kBatchTokens);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (batch->count == 0) {
+                    finished = true;
+                } else {
+                    ++produced;
+                }
+            }
+            ready.notify_one();
+            if (batch->count == 0) return;
+        }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = std::current_exception();
+            finished = true;
+        }
+        ready.notify_one();
+    }
+}
+
+size_t BackgroundLexer::fill(const TokenSlots& out, size_t max) {
+    std::unique_lock<std::mutex> lock(mutex);
+    ready.wait(lock, [this] { return consumed < produced || finished; });
+    if (consumed == produced) {
+        // Tokens lexed before a failure are still delivered first.
+        if (error) std::rethrow_exception(error);
+        return 0;
+    }
+    // A published batch is not touched by the producer until released.
+    const Batch& batch = batches[consumed % kBatchCount];
+    lock.unlock();
+
+    size_t count = std::min(max, batch.count - readPosition);
+    std::copy_n(&batch.types[readPosition], count, out.types);
+    std::copy_n(&batch.atoms[readPosition], count, out.atoms);
+    std::copy_n(&batch.offsets[readPosition], count, out.offsets);
+    std::copy_n(&batch.lengths[readPosition], count, out.lengths);
+    readPosition += count;
+    if (readPosition == batch.count) {
+        readPosition = 0;
+        lock.lock();
+        ++consumed;
+        lock.unlock();
+        space.notify_one();
+    }
+    return count;
+}
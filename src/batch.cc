@@ -0,0 +1,252 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 11:20:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 11:20:00 
+ */
+#include "batch.h"
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+#include "file_io.h"
+#include "pipeline.h"
+#include "result_cache.h"
+#include "source_map.h"
+#include "stats.h"
+#include "thread_pool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct BatchJob {
+    std::string input;
+    std::string output;
+    uintmax_t size;
+};
+
+constexpr const char* kOutputSuffix = ".obf.js";
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool isBatchSource(const fs::path& path) {
+    return path.extension() == ".js" && !endsWith(path.filename().string(), kOutputSuffix);
+}
+
+// errno is thread-local, but strerror() may share a static buffer.
+std::string errnoMessage() {
+    return std::generic_category().message(errno);
+}
+
+class JobCollector {
+public:
+    explicit JobCollector(const std::string& outDir) : outDir(outDir) {}
+
+    bool addEntry(const std::string& entry) {
+        if (entry.size() > 1 && entry[0] == '@') return addManifest(entry.substr(1));
+        return addPath(entry);
+    }
+
+    std::vector<BatchJob> jobs;
+
+private:
+    bool addManifest(const std::string& manifest) {
+        std::ifstream in(manifest);
+        if (!in) {
+            std::cerr << "Error: Cannot open manifest " << manifest << ": " << errnoMessage() << std::endl;
+            return false;
+        }
+        std::string line;
+        bool ok = true;
+        while (std::getline(in, line)) {
+            size_t begin = line.find_first_not_of(" \t\r");
+            if (begin == std::string::npos || line[begin] == '#') continue;
+            size_t end = line.find_last_not_of(" \t\r");
+            ok = addPath(line.substr(begin, end - begin + 1)) && ok;
+        }
+        return ok;
+    }
+
+    bool addPath(const std::string& path) {
+        std::error_code ec;
+        if (!fs::is_directory(path, ec)) {
+            return addFile(path, fs::path(path).filename());
+        }
+        std::vector<fs::path> found;
+        for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec) && isBatchSource(it->path())) found.push_back(it->path());
+        }
+        if (ec) {
+            std::cerr << "Error: Cannot read directory " << path << ": " << ec.message() << std::endl;
+            return false;
+        }
+        // Directory order is filesystem-dependent; sort for stable reporting.
+        std::sort(found.begin(), found.end());
+        bool ok = true;
+        for (const fs::path& file : found) {
+            ok = addFile(file, file.lexically_relative(path)) && ok;
+        }
+        return ok;
+    }
+
+    bool addFile(const fs::path& input, const fs::path& relative) {
+        fs::path name = relative.stem();
+        name += kOutputSuffix;
+        fs::path output = outDir.empty()
+            ? input.parent_path() / name
+            : fs::path(outDir) / relative.parent_path() / name;
+        std::string outputKey = output.lexically_normal().string();
+        auto inserted = outputs.emplace(outputKey, input.string());
+        if (!inserted.second) {
+            std::cerr << "Error: " << input.string() << " and " << inserted.first->second
+                      << " would both be written to " << outputKey << std::endl;
+            return false;
+        }
+        std::error_code ec;
+        uintmax_t size = fs::file_size(input, ec);
+        jobs.push_back({input.string(), output.string(), ec ? 0 : size});
+        return true;
+    }
+
+    std::string outDir;
+    std::unordered_map<std::string, std::string> outputs;
+};
+
+// Same pipeline as a single-file run, minus the AST dump. Returns an error
+// message, or an empty string on success.
+std::string obfuscateFile(const BatchJob& job, const BatchOptions& options, bool& fromCache, RunStats* stats) {
+    ResultCache* cache = options.cache;
+    InputFile input;
+    {
+        OBF_STAT(PhaseTimer timer(stats, PHASE_READ);)
+        if (!input.open(job.input)) {
+            return "Cannot open file " + job.input + ": " + errnoMessage();
+        }
+    }
+    std::string cacheKey;
+    if (cache) {
+        cacheKey = cache->key(input.data());
+        InputFile cached;
+        if (cache->lookup(cacheKey, cached)) {
+            fromCache = true;
+            OBF_STAT(PhaseTimer timer(stats, PHASE_WRITE);)
+            if (!writeOutput(job.output, cached.data())) {
+                return "Cannot write " + job.output + ": " + errnoMessage();
+            }
+            OBF_STAT(if (stats) { stats->bytesIn += input.data().size(); stats->bytesOut += cached.data().size(); })
+            return std::string();
+        }
+    }
+    try {
+        // One context per worker thread, reused for every file it handles.
+        thread_local ObfuscationContext context;
+        context.setOptions(options.obfuscator);
+        SourceMap sourceMap;
+        if (options.sourceMaps) sourceMap.setPaths(job.input, job.output);
+        const std::string& obfuscatedCode =
+            context.run(input.data(), nullptr, stats, options.sourceMaps ? &sourceMap : nullptr);
+        OBF_STAT(PhaseTimer timer(stats, PHASE_WRITE);)
+        if (!writeOutput(job.output, obfuscatedCode)) {
+            return "Cannot write " + job.output + ": " + errnoMessage();
+        }
+        if (options.sourceMaps && !writeOutput(job.output + ".map", sourceMap.toJson())) {
+            return "Cannot write " + job.output + ".map: " + errnoMessage();
+        }
+        if (cache) cache->store(cacheKey, obfuscatedCode);
+    } catch (const std::exception& e) {
+        return job.input + ": " + e.what();
+    }
+    return std::string();
+}
+
+} // namespace
+
+int runBatch(const BatchOptions& options) {
+    JobCollector collector(options.outDir);
+    bool ok = true;
+    for (const std::string& entry : options.inputs) {
+        ok = collector.addEntry(entry) && ok;
+    }
+    if (!ok) return 1;
+    std::vector<BatchJob>& jobs = collector.jobs;
+    if (jobs.empty()) {
+        std::cerr << "Error: No input files" << std::endl;
+        return 1;
+    }
+
+    // Create output directories up front so workers never race on them.
+    std::unordered_set<std::string> createdDirs;
+    for (const BatchJob& job : jobs) {
+        fs::path dir = fs::path(job.output).parent_path();
+        if (dir.empty() || !createdDirs.insert(dir.string()).second) continue;
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        if (ec) {
+            std::cerr << "Error: Cannot create directory " << dir.string() << ": " << ec.message() << std::endl;
+            return 1;
+        }
+    }
+
+    // Start the largest files first so a big chunk submitted last does not
+    // leave the other workers idle at the end.
+    std::vector<size_t> order(jobs.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&jobs](size_t a, size_t b) {
+        return jobs[a].size > jobs[b].size;
+    });
+
+    size_t threads = options.threads == 0 ? ThreadPool::defaultThreadCount() : options.threads;
+    std::vector<std::string> errors(jobs.size());
+    // Not vector<bool>: workers write neighbouring elements concurrently.
+    std::vector<char> cached(jobs.size(), false);
+#if CURSIOBFUSCATOR_STATS
+    std::vector<RunStats> jobStats(options.stats ? jobs.size() : 0);
+#endif
+    {
+        ThreadPool pool(std::min(threads, jobs.size()));
+        for (size_t index : order) {
+            pool.submit([&, index] {
+                RunStats* stats = nullptr;
+                OBF_STAT(if (options.stats) stats = &jobStats[index];)
+                bool fromCache = false;
+                errors[index] = obfuscateFile(jobs[index], options, fromCache, stats);
+                cached[index] = fromCache;
+            });
+        }
+        pool.wait();
+    }
+    if (options.cache) options.cache->evict();
+
+#if CURSIOBFUSCATOR_STATS
+    if (options.stats) {
+        // Per-phase CPU time cannot be attributed per worker with clock().
+        options.stats->phaseCpu = false;
+        for (size_t i = 0; i < jobStats.size(); ++i) {
+            if (!errors[i].empty()) continue;
+            options.stats->merge(jobStats[i]);
+            ++options.stats->files;
+            if (cached[i]) ++options.stats->cacheHits;
+        }
+    }
+#endif
+
+    size_t failed = 0;
+    for (const std::string& error : errors) {
+        if (error.empty()) continue;
+        std::cerr << "Error: " << error << std::endl;
+        ++failed;
+    }
+    std::cout << "Obfuscated " << (jobs.size() - failed) << " of " << jobs.size() << " files";
+    if (options.cache) {
+        std::cout << " (" << std::count(cached.begin(), cached.end(), true) << " from cache)";
+    }
+    std::cout << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 19:30:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 19:30:00 
+ */
+#include "constant_folder.h"
+#include <cmath>
+#include <string>
+#include <string_view>
+#include "lexer.h"
+
+namespace {
+
+// Literals longer than this could exceed 2^53, past which integers are no
+// longer exact doubles.
+constexpr size_t kMaxLiteralDigits = 15;
+constexpr double kMaxExactInteger = 9007199254740992.0;
+
+// A literal operand's value: a number, or a string's decoded text.
+struct Constant {
+    bool isString = false;
+    double number = 0;
+    std::string text;
+};
+
+bool isDigits(std::string_view text) {
+    if (text.empty()) return false;
+    for (char c : text) {
+        if (c < '0' || c > '9') return false;
+    }
+    return true;
+}
+
+// A double-quoted literal whose value is text.
+void appendQuoted(std::string& out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c == '\n') out += "\\n";
+        else if (c == '\r') out += "\\r";
+        else out += c;
+    }
+    out += '"';
+}
+
+bool isConcatenation(const ASTNode& node) {
+    return (node.type == ASTNodeType::EXPRESSION || node.type == ASTNodeType::BINARY_EXPRESSION) &&
+           node.value == ATOM_PLUS && node.childCount == 2;
+}
+
+class Folder {
+public:
+    Folder(AST& ast, AtomTable& atoms) : ast(ast), atoms(atoms) {}
+
+    size_t run();
+
+private:
+    bool constantOf(NodeId id, Constant& value) const;
+    bool numberOf(const ASTNode& node, double& number) const;
+    bool foldUnary(NodeId id);
+    bool foldBinary(NodeId id);
+    bool foldConcatenation(NodeId id, const Constant& right);
+    void appendText(const Constant& value);
+    void makeNumber(NodeId id, double value);
+    void makeString(NodeId id);
+
+    AST& ast;
+    AtomTable& atoms;
+    std::string scratch;
+};
+
+// The parser adds an operator's node after its operands, so one pass in
+// node order sees every operand folded before the operator that uses it.
+size_t Folder::run() {
+    size_t folded = 0;
+    for (NodeId id = 0; id < ast.size(); ++id) {
+        switch (ast[id].type) {
+            case ASTNodeType::EXPRESSION:
+            case ASTNodeType::BINARY_EXPRESSION:
+                if (foldBinary(id)) ++folded;
+                break;
+            case ASTNodeType::UNARY_EXPRESSION:
+                if (foldUnary(id)) ++folded;
+                break;
+            default:
+                break;
+        }
+    }
+    return folded;
+}
+
+bool Folder::constantOf(NodeId id, Constant& value) const {
+    const ASTNode& node = ast[id];
+    switch (node.type) {
+        case ASTNodeType::NUMBER:
+            value.isString = false;
+            return numberOf(node, value.number);
+        case ASTNodeType::STRING:
+            value.isString = true;
+            value.text.clear();
+            appendStringValue(value.text, atoms.str(node.value));
+            return true;
+        case ASTNodeType::UNARY_EXPRESSION: {
+            // Operands are folded first, and the only constant left behind
+            // as a unary is a minus on a literal, so one level is enough
+            // and a long chain of signs is never walked end to end.
+            if (node.value != ATOM_MINUS && node.value != ATOM_PLUS) return false;
+            bool negative = node.value == ATOM_MINUS;
+            const ASTNode* operand = &ast[node.firstChild];
+            if (operand->type == ASTNodeType::UNARY_EXPRESSION && operand->value == ATOM_MINUS) {
+                negative = !negative;
+                operand = &ast[operand->firstChild];
+            }
+            if (operand->type != ASTNodeType::NUMBER || !numberOf(*operand, value.number)) return false;
+            value.isString = false;
+            if (negative) value.number = -value.number;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Anything but plain decimal digits is left to the obfuscator, and so is a
+// leading zero, which makes 010 a legacy octal 8.
+bool Folder::numberOf(const ASTNode& node, double& number) const {
+    std::string_view text = atoms.str(node.value);
+    if (text.size() > kMaxLiteralDigits || !isDigits(text) || (text.size() > 1 && text[0] == '0')) return false;
+    number = 0;
+    for (char c : text) number = number * 10 + (c - '0');
+    return true;
+}
+
+bool Folder::foldUnary(NodeId id) {
+    const ASTNode& node = ast[id];
+    Constant value;
+    if (!constantOf(id, value)) return false;
+    // -1 is already as small as it gets.
+    if (node.value == ATOM_MINUS && ast[node.firstChild].type == ASTNodeType::NUMBER) return false;
+    makeNumber(id, value.number);
+    return true;
+}
+
+bool Folder::foldBinary(NodeId id) {
+    const ASTNode& node = ast[id];
+    if (node.childCount != 2) return false;
+    NodeId left = node.firstChild;
+    Constant a;
+    Constant b;
+    if (!constantOf(node.lastChild, b)) return false;
+    if (!constantOf(left, a)) return foldConcatenation(id, b);
+
+    if (node.value == ATOM_PLUS && (a.isString || b.isString)) {
+        scratch.clear();
+        appendText(a);
+        appendText(b);
+        makeString(id);
+        return true;
+    }
+    if (a.isString || b.isString) return false;
+    double result;
+    switch (node.value) {
+        case ATOM_PLUS: result = a.number + b.number; break;
+        case ATOM_MINUS: result = a.number - b.number; break;
+        case ATOM_STAR: result = a.number * b.number; break;
+        case ATOM_SLASH:
+            if (b.number == 0) return false;
+            result = a.number / b.number;
+            break;
+        case ATOM_PERCENT:
+            if (b.number == 0) return false;
+            result = std::fmod(a.number, b.number);
+            break;
+        default:
+            return false;
+    }
+    if (result != std::trunc(result) || std::fabs(result) >= kMaxExactInteger) return false;
+    makeNumber(id, result);
+    return true;
+}
+
+// x + "a" + right, parsed as (x + "a") + right, becomes x + "a<right>".
+bool Folder::foldConcatenation(NodeId id, const Constant& right) {
+    NodeId inner = ast[id].firstChild;
+    if (!isConcatenation(ast[inner])) return false;
+    NodeId literal = ast[inner].lastChild;
+    if (ast[literal].type != ASTNodeType::STRING) return false;
+    scratch.clear();
+    appendStringValue(scratch, atoms.str(ast[literal].value));
+    appendText(right);
+    makeString(literal);
+    ASTNode& node = ast[id];
+    node.firstChild = ast[inner].firstChild;
+    node.lastChild = literal;
+    return true;
+}
+
+// JavaScript's String() of the value. Numbers here are integers below
+// 2^53, which print as plain digits, and -0 prints as 0.
+void Folder::appendText(const Constant& value) {
+    if (value.isString) {
+        scratch += value.text;
+    } else if (value.number == 0) {
+        scratch += '0';
+    } else {
+        scratch += std::to_string(static_cast<long long>(value.number));
+    }
+}
+
+// Turns id into a literal, or into a unary minus on one for negative
+// values and -0. The minus reuses id's first operand for the literal.
+void Folder::makeNumber(NodeId id, double value) {
+    Atom digits = atoms.intern(std::to_string(static_cast<long long>(std::fabs(value))));
+    ASTNode& node = ast[id];
+    NodeId literal = INVALID_NODE;
+    if (std::signbit(value)) {
+        literal = node.firstChild;
+        ASTNode& operand = ast[literal];
+        operand.type = ASTNodeType::NUMBER;
+        operand.value = digits;
+        operand.firstChild = INVALID_NODE;
+        operand.lastChild = INVALID_NODE;
+        operand.nextSibling = INVALID_NODE;
+        operand.childCount = 0;
+        node.type = ASTNodeType::UNARY_EXPRESSION;
+        node.value = ATOM_MINUS;
+    } else {
+        node.type = ASTNodeType::NUMBER;
+        node.value = digits;
+    }
+    node.firstChild = literal;
+    node.lastChild = literal;
+    node.childCount = literal == INVALID_NODE ? 0 : 1;
+}
+
+// Turns id into a string literal for the text held in scratch.
+void Folder::makeString(NodeId id) {
+    std::string literal;
+    literal.reserve(scratch.size() + 2);
+    appendQuoted(literal, scratch);
+    Atom value = atoms.intern(literal);
+    ASTNode& node = ast[id];
+    node.type = ASTNodeType::STRING;
+    node.value = value;
+    node.firstChild = INVALID_NODE;
+    node.lastChild = INVALID_NODE;
+    node.childCount = 0;
+}
+
+} // namespace
+
+size_t foldConstants(AST& ast, AtomTable& atoms) {
+    return Folder(ast, atoms).run();
+}
@@ -0,0 +1,114 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 14:10:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 14:10:00 
+ */
+#include "cursiobfuscator.h"
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <string>
+#include "pipeline.h"
+#include "thread_pool.h"
+
+#ifndef CURSIOBFUSCATOR_VERSION
+#define CURSIOBFUSCATOR_VERSION "unknown"
+#endif
+
+static_assert(CURSIOBFUSCATOR_STRINGS_HEX == static_cast<int>(StringEncoding::HEX) &&
+              CURSIOBFUSCATOR_STRINGS_SHUFFLE == static_cast<int>(StringEncoding::SHUFFLE) &&
+              CURSIOBFUSCATOR_STRINGS_BASE64 == static_cast<int>(StringEncoding::BASE64) &&
+              CURSIOBFUSCATOR_STRINGS_XOR == static_cast<int>(StringEncoding::XOR),
+              "cursiobfuscator_string_encoding must match StringEncoding");
+static_assert(CURSIOBFUSCATOR_NAMES_HEX == static_cast<int>(NameStyle::HEX) &&
+              CURSIOBFUSCATOR_NAMES_SHORT == static_cast<int>(NameStyle::SHORT),
+              "cursiobfuscator_name_style must match NameStyle");
+
+// True when a caller's struct of struct_size bytes holds the whole field.
+#define OPTION_COVERED(options, field) \
+    ((options)->struct_size >= offsetof(cursiobfuscator_options, field) + sizeof((options)->field))
+
+struct cursiobfuscator_context {
+    // Declared before the pipeline, which borrows it.
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<ObfuscationContext> pipeline;
+    std::string lastError;
+};
+
+namespace {
+
+cursiobfuscator_status fail(cursiobfuscator_context* context, cursiobfuscator_status status, const char* message) {
+    context->lastError = message;
+    return status;
+}
+
+} // namespace
+
+const char* cursiobfuscator_version(void) {
+    return CURSIOBFUSCATOR_VERSION;
+}
+
+cursiobfuscator_context* cursiobfuscator_context_new(const cursiobfuscator_options* options) {
+    cursiobfuscator_options settings;
+    cursiobfuscator_options_init(&settings);
+    if (options) {
+        // A field is read only from layouts that have it; the rest keep
+        // their defaults.
+        if (!OPTION_COVERED(options, threads)) return nullptr;
+        settings.threads = options->threads;
+        if (OPTION_COVERED(options, string_encoding)) settings.string_encoding = options->string_encoding;
+        if (OPTION_COVERED(options, name_style)) settings.name_style = options->name_style;
+        if (OPTION_COVERED(options, compact)) settings.compact = options->compact;
+    }
+    if (settings.string_encoding > CURSIOBFUSCATOR_STRINGS_XOR) return nullptr;
+    if (settings.name_style > CURSIOBFUSCATOR_NAMES_SHORT) return nullptr;
+    ObfuscatorOptions obfuscatorOptions;
+    obfuscatorOptions.strings = static_cast<StringEncoding>(settings.string_encoding);
+    obfuscatorOptions.names = static_cast<NameStyle>(settings.name_style);
+    obfuscatorOptions.compact = settings.compact != 0;
+    try {
+        std::unique_ptr<cursiobfuscator_context> context(new cursiobfuscator_context);
+        if (settings.threads > 1) context->pool = std::make_unique<ThreadPool>(settings.threads);
+        context->pipeline = std::make_unique<ObfuscationContext>(context->pool.get(), obfuscatorOptions);
+        return context.release();
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+void cursiobfuscator_context_free(cursiobfuscator_context* context) {
+    delete context;
+}
+
+cursiobfuscator_status cursiobfuscator_obfuscate(cursiobfuscator_context* context, const char* input,
+                                                 size_t input_size, const char** output, size_t* output_size) {
+    if (!context) return CURSIOBFUSCATOR_INVALID_ARGUMENT;
+    if (output) *output = nullptr;
+    if (output_size) *output_size = 0;
+    if (!output || !output_size || (!input && input_size != 0)) {
+        return fail(context, CURSIOBFUSCATOR_INVALID_ARGUMENT, "output pointers must be set, input may be NULL only when empty");
+    }
+    try {
+        const std::string& code = context->pipeline->run(std::string_view(input, input_size));
+        context->lastError.clear();
+        *output = code.data();
+        *output_size = code.size();
+        return CURSIOBFUSCATOR_OK;
+    } catch (const std::bad_alloc&) {
+        return fail(context, CURSIOBFUSCATOR_OUT_OF_MEMORY, "out of memory");
+    } catch (const std::exception& e) {
+        return fail(context, CURSIOBFUSCATOR_INPUT_ERROR, e.what());
+    }
+}
+
+void cursiobfuscator_context_reset(cursiobfuscator_context* context) {
+    if (!context) return;
+    context->pipeline->reset();
+    context->lastError.clear();
+}
+
+const char* cursiobfuscator_last_error(const cursiobfuscator_context* context) {
+    return context ? context->lastError.c_str() : "";
+}
@@ -0,0 +1,174 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 09:40:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 09:40:00 
+ */
+#include "file_io.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t kStreamChunk = 1 << 16;
+
+#ifndef _WIN32
+bool readAll(int fd, std::string& out, size_t sizeHint) {
+    out.resize(sizeHint > 0 ? sizeHint : kStreamChunk);
+    size_t used = 0;
+    for (;;) {
+        if (used == out.size()) out.resize(out.size() * 2);
+        ssize_t n = ::read(fd, &out[used], out.size() - used);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) break;
+        used += static_cast<size_t>(n);
+        if (sizeHint > 0 && used == sizeHint) break;
+    }
+    out.resize(used);
+    return true;
+}
+#endif
+
+} // namespace
+
+InputFile::~InputFile() {
+#ifndef _WIN32
+    if (mapped) ::munmap(mapped, mappedSize);
+#endif
+}
+
+#ifdef _WIN32
+
+bool InputFile::open(const std::string& path) {
+    FILE* file = stdin;
+    if (path == "-") {
+        _setmode(_fileno(stdin), _O_BINARY);
+    } else if (!(file = std::fopen(path.c_str(), "rb"))) {
+        return false;
+    }
+    char chunk[kStreamChunk];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        buffer.append(chunk, n);
+    }
+    bool ok = !std::ferror(file);
+    if (file != stdin) std::fclose(file);
+    view = buffer;
+    return ok;
+}
+
+bool writeOutput(const std::string& path, const std::vector<std::string_view>& chunks) {
+    FILE* file = stdout;
+    if (path == "-") {
+        _setmode(_fileno(stdout), _O_BINARY);
+    } else if (!(file = std::fopen(path.c_str(), "wb"))) {
+        return false;
+    }
+    bool ok = true;
+    for (std::string_view chunk : chunks) {
+        if (std::fwrite(chunk.data(), 1, chunk.size(), file) != chunk.size()) ok = false;
+    }
+    if (std::fflush(file) != 0) ok = false;
+    if (file != stdout) std::fclose(file);
+    return ok;
+}
+
+#else
+
+bool InputFile::open(const std::string& path) {
+    if (path == "-") {
+        if (!readAll(STDIN_FILENO, buffer, 0)) return false;
+        view = buffer;
+        return true;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    bool ok = true;
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_t size = static_cast<size_t>(st.st_size);
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            ::madvise(addr, size, MADV_SEQUENTIAL);
+            mapped = addr;
+            mappedSize = size;
+            view = std::string_view(static_cast<const char*>(addr), size);
+        } else {
+            ok = readAll(fd, buffer, size);
+            view = buffer;
+        }
+    } else {
+        ok = readAll(fd, buffer, 0);
+        view = buffer;
+    }
+    ::close(fd);
+    return ok;
+}
+
+bool writeOutput(const std::string& path, const std::vector<std::string_view>& chunks) {
+    int fd = STDOUT_FILENO;
+    if (path != "-") {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+    }
+
+    std::vector<struct iovec> iov;
+    iov.reserve(chunks.size());
+    for (std::string_view chunk : chunks) {
+        if (!chunk.empty()) iov.push_back({ const_cast<char*>(chunk.data()), chunk.size() });
+    }
+
+    bool ok = true;
+    size_t next = 0;
+    while (next < iov.size()) {
+        int count = static_cast<int>(std::min<size_t>(iov.size() - next, IOV_MAX));
+        ssize_t n = ::writev(fd, &iov[next], count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        // Skip fully written buffers and trim a partially written one.
+        size_t written = static_cast<size_t>(n);
+        while (next < iov.size() && written >= iov[next].iov_len) {
+            written -= iov[next].iov_len;
+            ++next;
+        }
+        if (written > 0) {
+            iov[next].iov_base = static_cast<char*>(iov[next].iov_base) + written;
+            iov[next].iov_len -= written;
+        }
+    }
+
+    if (fd != STDOUT_FILENO && ::close(fd) != 0) ok = false;
+    return ok;
+}
+
+#endif
+
+bool writeOutput(const std::string& path, std::string_view data) {
+    return writeOutput(path, std::vector<std::string_view>{ data });
+}
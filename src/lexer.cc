@@ -5,78 +5,614 @@
  * @Last Modified time: 2025-10-10 18:12:11 
  */
 #include "../include/lexer.h"
-#include <regex>
-#include <string>
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <stdexcept>
 #include <iostream>
-#include <cctype>
-
-Lexer::Lexer(const std::string& source) : sourceCode(source) {}
-
-std::vector<Token> Lexer::tokenize() {
-    std::vector<Token> tokens;
-    const std::vector<std::string> keywords = {
-        "if", "else", "for", "while", "return", "function",
-        "const", "let", "var", "async", "await", "class", "new", "this", "super"
-    };
-
-    std::regex keywordRegex(R"((if|else|for|while|return|function|const|let|var|async|await|class|new|this|super)\b)");
-    std::regex identifierRegex(R"([a-zA-Z_][a-zA-Z0-9_]*)");
-    std::regex numberRegex(R"(\d+(\.\d+)?([eE][+-]?\d+)?)");
-    std::regex stringRegex(R"("([^"\\]|\\.)*"|'([^'\\]|\\.)*')");
-    std::regex templateStringRegex(R"(`([^`\\]|\\.)*`)");
-    std::regex operatorRegex(R"(===|!==|>>>=|>>>|>>=|<<=|==|!=|<=|>=|\+\+|--|\+|-|\*|\/|%|=|<|>|\!|&&|\|\||\?|:|\^|&|\||~)");
-    std::regex symbolRegex(R"([{}()\[\];,\.])");
-
-    size_t pos = 0;
-    while (pos < sourceCode.length()) {
-        if (isspace(sourceCode[pos])) {
-            pos++;
-            continue;
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LEXER_X86_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LEXER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define LEXER_TARGET_AVX2
+#endif
+
+namespace {
+
+// Character classes used to pick the scanning rule from the first byte of a token.
+enum CharClass : uint8_t {
+    CC_OTHER,
+    CC_SPACE,
+    CC_IDENT_START,
+    CC_DIGIT,
+    CC_QUOTE,
+    CC_OPERATOR,
+    CC_SYMBOL
+};
+
+constexpr std::array<uint8_t, 256> makeCharClassTable() {
+    std::array<uint8_t, 256> table{};
+    for (int c = 'a'; c <= 'z'; ++c) table[c] = CC_IDENT_START;
+    for (int c = 'A'; c <= 'Z'; ++c) table[c] = CC_IDENT_START;
+    table['_'] = CC_IDENT_START;
+    for (int c = '0'; c <= '9'; ++c) table[c] = CC_DIGIT;
+    for (char c : {' ', '\t', '\n', '\v', '\f', '\r'}) table[static_cast<uint8_t>(c)] = CC_SPACE;
+    table['"'] = CC_QUOTE;
+    table['\''] = CC_QUOTE;
+    table['`'] = CC_QUOTE;
+    for (char c : {'=', '!', '<', '>', '+', '-', '*', '/', '%', '&', '|', '^', '~', '?', ':'}) {
+        table[static_cast<uint8_t>(c)] = CC_OPERATOR;
+    }
+    for (char c : {'{', '}', '(', ')', '[', ']', ';', ',', '.'}) table[static_cast<uint8_t>(c)] = CC_SYMBOL;
+    return table;
+}
+
+constexpr std::array<bool, 256> makeIdentPartTable() {
+    std::array<bool, 256> table{};
+    for (int c = 'a'; c <= 'z'; ++c) table[c] = true;
+    for (int c = 'A'; c <= 'Z'; ++c) table[c] = true;
+    for (int c = '0'; c <= '9'; ++c) table[c] = true;
+    table['_'] = true;
+    return table;
+}
+
+constexpr auto kCharClass = makeCharClassTable();
+constexpr auto kIdentPart = makeIdentPartTable();
+
+struct Keyword {
+    std::string_view text;
+    Atom atom;
+};
+
+constexpr Keyword kKeywords[] = {
+    { "if", ATOM_IF }, { "else", ATOM_ELSE }, { "for", ATOM_FOR }, { "while", ATOM_WHILE },
+    { "return", ATOM_RETURN }, { "function", ATOM_FUNCTION }, { "const", ATOM_CONST },
+    { "let", ATOM_LET }, { "var", ATOM_VAR }, { "async", ATOM_ASYNC }, { "await", ATOM_AWAIT },
+    { "class", ATOM_CLASS }, { "new", ATOM_NEW }, { "this", ATOM_THIS }, { "super", ATOM_SUPER }
+};
+constexpr size_t kKeywordCount = sizeof(kKeywords) / sizeof(kKeywords[0]);
+constexpr size_t kMinKeywordLength = 2;
+constexpr size_t kMaxKeywordLength = 8;
+
+// Perfect hash over kKeywords: length, first and last byte pick one of 32
+// slots, and no two keywords share a slot, so lookup is one compare.
+constexpr size_t kKeywordSlots = 32;
+constexpr uint8_t kNoKeyword = 0xff;
+
+constexpr size_t keywordHash(std::string_view word) {
+    return (word.size() + static_cast<uint8_t>(word.front()) + static_cast<uint8_t>(word.back()) * 11) &
+           (kKeywordSlots - 1);
+}
+
+constexpr std::array<uint8_t, kKeywordSlots> makeKeywordTable() {
+    std::array<uint8_t, kKeywordSlots> table{};
+    for (uint8_t& slot : table) slot = kNoKeyword;
+    for (size_t i = 0; i < kKeywordCount; ++i) table[keywordHash(kKeywords[i].text)] = static_cast<uint8_t>(i);
+    return table;
+}
+
+constexpr auto kKeywordTable = makeKeywordTable();
+
+constexpr bool keywordHashIsPerfect() {
+    for (size_t i = 0; i < kKeywordCount; ++i) {
+        size_t length = kKeywords[i].text.size();
+        if (kKeywordTable[keywordHash(kKeywords[i].text)] != i) return false;
+        if (length < kMinKeywordLength || length > kMaxKeywordLength) return false;
+    }
+    return true;
+}
+static_assert(keywordHashIsPerfect(), "keywordHash collides or kKeywords outgrew the length bounds; retune it");
+
+inline uint8_t charClass(char c) { return kCharClass[static_cast<uint8_t>(c)]; }
+inline bool isIdentPart(char c) { return kIdentPart[static_cast<uint8_t>(c)]; }
+inline bool isDigit(char c) { return charClass(c) == CC_DIGIT; }
+
+// The keyword's atom, or INVALID_ATOM for any other identifier.
+Atom keywordAtom(std::string_view word) {
+    if (word.size() < kMinKeywordLength || word.size() > kMaxKeywordLength) return INVALID_ATOM;
+    uint8_t index = kKeywordTable[keywordHash(word)];
+    if (index == kNoKeyword || kKeywords[index].text != word) return INVALID_ATOM;
+    return kKeywords[index].atom;
+}
+
+// Scalar kernels. Each returns the first byte at or after p that ends the run.
+const char* skipWhitespaceScalar(const char* p, const char* end) {
+    while (p < end && charClass(*p) == CC_SPACE) ++p;
+    return p;
+}
+
+const char* skipIdentPartScalar(const char* p, const char* end) {
+    while (p < end && isIdentPart(*p)) ++p;
+    return p;
+}
+
+const char* findQuoteOrEscapeScalar(const char* p, const char* end, char quote) {
+    while (p < end && *p != quote && *p != '\\') ++p;
+    return p;
+}
+
+#ifdef LEXER_X86_SIMD
+
+inline unsigned firstSetBit(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// Unsigned "lo <= v <= lo + span" per byte.
+inline __m128i inRange16(__m128i v, char lo, char span) {
+    __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(span)), shifted);
+}
+
+inline __m128i whitespaceMask16(__m128i v) {
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), inRange16(v, '\t', '\r' - '\t'));
+}
+
+inline __m128i identPartMask16(__m128i v) {
+    __m128i letter = inRange16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z' - 'a');
+    __m128i digit = inRange16(v, '0', 9);
+    __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(letter, digit), underscore);
+}
+
+const char* skipWhitespaceSSE2(const char* p, const char* end) {
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint32_t miss = ~static_cast<uint32_t>(_mm_movemask_epi8(whitespaceMask16(v))) & 0xFFFF;
+        if (miss) return p + firstSetBit(miss);
+    }
+    return skipWhitespaceScalar(p, end);
+}
+
+const char* skipIdentPartSSE2(const char* p, const char* end) {
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint32_t miss = ~static_cast<uint32_t>(_mm_movemask_epi8(identPartMask16(v))) & 0xFFFF;
+        if (miss) return p + firstSetBit(miss);
+    }
+    return skipIdentPartScalar(p, end);
+}
+
+const char* findQuoteOrEscapeSSE2(const char* p, const char* end, char quote) {
+    const __m128i quoteVec = _mm_set1_epi8(quote);
+    const __m128i escapeVec = _mm_set1_epi8('\\');
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, quoteVec), _mm_cmpeq_epi8(v, escapeVec));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+        if (mask) return p + firstSetBit(mask);
+    }
+    return findQuoteOrEscapeScalar(p, end, quote);
+}
+
+LEXER_TARGET_AVX2 inline __m256i inRange32(__m256i v, char lo, char span) {
+    __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(span)), shifted);
+}
+
+LEXER_TARGET_AVX2 const char* skipWhitespaceAVX2(const char* p, const char* end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), inRange32(v, '\t', '\r' - '\t'));
+        uint32_t miss = ~static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (miss) return p + firstSetBit(miss);
+    }
+    return skipWhitespaceSSE2(p, end);
+}
+
+LEXER_TARGET_AVX2 const char* skipIdentPartAVX2(const char* p, const char* end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i letter = inRange32(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z' - 'a');
+        __m256i digit = inRange32(v, '0', 9);
+        __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(letter, digit), underscore);
+        uint32_t miss = ~static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (miss) return p + firstSetBit(miss);
+    }
+    return skipIdentPartSSE2(p, end);
+}
+
+LEXER_TARGET_AVX2 const char* findQuoteOrEscapeAVX2(const char* p, const char* end, char quote) {
+    const __m256i quoteVec = _mm256_set1_epi8(quote);
+    const __m256i escapeVec = _mm256_set1_epi8('\\');
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, quoteVec), _mm256_cmpeq_epi8(v, escapeVec));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask) return p + firstSetBit(mask);
+    }
+    return findQuoteOrEscapeSSE2(p, end, quote);
+}
+
+bool cpuHasAVX2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // LEXER_X86_SIMD
+
+struct ScanKernels {
+    const char* (*skipWhitespace)(const char* p, const char* end);
+    const char* (*skipIdentPart)(const char* p, const char* end);
+    const char* (*findQuoteOrEscape)(const char* p, const char* end, char quote);
+};
+
+// Picks the widest kernel set the running CPU supports, once per process.
+const ScanKernels& scanKernels() {
+    static const ScanKernels kernels = [] {
+#ifdef LEXER_X86_SIMD
+        if (cpuHasAVX2()) {
+            return ScanKernels{ skipWhitespaceAVX2, skipIdentPartAVX2, findQuoteOrEscapeAVX2 };
         }
+        return ScanKernels{ skipWhitespaceSSE2, skipIdentPartSSE2, findQuoteOrEscapeSSE2 };
+#else
+        return ScanKernels{ skipWhitespaceScalar, skipIdentPartScalar, findQuoteOrEscapeScalar };
+#endif
+    }();
+    return kernels;
+}
 
-        std::string remaining = sourceCode.substr(pos);
-        std::smatch match;
+// Most identifiers are short, so the first few bytes are checked inline and
+// the vector kernel only takes over for longer runs.
+constexpr size_t kInlineScanBytes = 8;
 
-        if (std::regex_search(remaining, match, keywordRegex) && match.position() == 0) {
-            tokens.push_back({ TokenType::KEYWORD, match.str() });
-            pos += match.length();
-            continue;
+size_t scanIdentifier(const ScanKernels& scan, const char* p, const char* end) {
+    const char* limit = end - p > static_cast<ptrdiff_t>(kInlineScanBytes) ? p + kInlineScanBytes : end;
+    const char* cur = p + 1;
+    while (cur < limit && isIdentPart(*cur)) ++cur;
+    if (cur == limit && cur < end) cur = scan.skipIdentPart(cur, end);
+    return static_cast<size_t>(cur - p);
+}
+
+// \d+(\.\d+)?([eE][+-]?\d+)?
+size_t scanNumber(const char* p, const char* end) {
+    const char* start = p;
+    while (p < end && isDigit(*p)) ++p;
+    if (p + 1 < end && *p == '.' && isDigit(p[1])) {
+        p += 2;
+        while (p < end && isDigit(*p)) ++p;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* exp = p + 1;
+        if (exp < end && (*exp == '+' || *exp == '-')) ++exp;
+        if (exp < end && isDigit(*exp)) {
+            p = exp + 1;
+            while (p < end && isDigit(*p)) ++p;
         }
-        if (std::regex_search(remaining, match, identifierRegex) && match.position() == 0) {
-            tokens.push_back({ TokenType::IDENTIFIER, match.str() });
-            pos += match.length();
-            continue;
+    }
+    return static_cast<size_t>(p - start);
+}
+
+// Quoted literal where a backslash escapes any character except a line
+// terminator. Returns 0 when the literal is not terminated.
+size_t scanQuoted(const ScanKernels& scan, const char* p, const char* end) {
+    const char quote = *p;
+    const char* cur = p + 1;
+    while ((cur = scan.findQuoteOrEscape(cur, end, quote)) < end) {
+        if (*cur == quote) return static_cast<size_t>(cur - p) + 1;
+        if (cur + 1 >= end || cur[1] == '\n' || cur[1] == '\r') return 0;
+        cur += 2;
+    }
+    return 0;
+}
+
+// Longest operator starting at p: every punctuator that can be spelled
+// with the operator characters, including compound assignments.
+size_t scanOperator(const char* p, const char* end) {
+    auto at = [&](size_t i, char c) { return p + i < end && p[i] == c; };
+    switch (*p) {
+        case '=':
+        case '!':
+            if (at(1, '=')) return at(2, '=') ? 3 : 2;
+            return 1;
+        case '>':
+            if (at(1, '>')) {
+                if (at(2, '>')) return at(3, '=') ? 4 : 3;
+                return at(2, '=') ? 3 : 2;
+            }
+            return at(1, '=') ? 2 : 1;
+        case '<':
+            if (at(1, '<')) return at(2, '=') ? 3 : 2;
+            return at(1, '=') ? 2 : 1;
+        case '+':
+        case '-':
+        case '&':
+        case '|':
+            return at(1, *p) || at(1, '=') ? 2 : 1;
+        case '*':
+        case '/':
+        case '%':
+        case '^':
+            return at(1, '=') ? 2 : 1;
+        default:
+            return 1;
+    }
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Value of the count hex digits at p, or -1.
+long hexDigits(const char* p, const char* end, size_t count) {
+    if (static_cast<size_t>(end - p) < count) return -1;
+    long value = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int digit = hexValue(p[i]);
+        if (digit < 0) return -1;
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+void appendUtf8(std::string& out, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | codePoint >> 6);
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | codePoint >> 12);
+        out += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | codePoint >> 18);
+        out += static_cast<char>(0x80 | (codePoint >> 12 & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+// Decodes the escape sequence after a backslash at p, which is not at end.
+// Returns where the sequence ends.
+const char* appendEscape(std::string& out, const char* p, const char* end) {
+    char c = *p++;
+    switch (c) {
+        case 'n': out += '\n'; return p;
+        case 't': out += '\t'; return p;
+        case 'r': out += '\r'; return p;
+        case 'b': out += '\b'; return p;
+        case 'f': out += '\f'; return p;
+        case 'v': out += '\v'; return p;
+        case '\r':
+            // Line continuations add nothing.
+            return p < end && *p == '\n' ? p + 1 : p;
+        case '\n':
+            return p;
+        case 'x': {
+            long value = hexDigits(p, end, 2);
+            if (value < 0) break;
+            appendUtf8(out, static_cast<uint32_t>(value));
+            return p + 2;
         }
-        if (std::regex_search(remaining, match, numberRegex) && match.position() == 0) {
-            tokens.push_back({ TokenType::NUMBER, match.str() });
-            pos += match.length();
-            continue;
+        case 'u': {
+            long value;
+            const char* next;
+            if (p < end && *p == '{') {
+                const char* close = std::find(p, end, '}');
+                value = close == end || close - p < 2 || close - p > 7 ? -1 : hexDigits(p + 1, close, close - p - 1);
+                next = close + 1;
+            } else {
+                value = hexDigits(p, end, 4);
+                next = p + 4;
+            }
+            if (value < 0 || value > 0x10FFFF) break;
+            appendUtf8(out, static_cast<uint32_t>(value));
+            return next;
         }
-        if (std::regex_search(remaining, match, stringRegex) && match.position() == 0) {
-            tokens.push_back({ TokenType::STRING, match.str() });
-            pos += match.length();
-            continue;
+        default:
+            break;
+    }
+    if (c >= '0' && c <= '7') {
+        // Legacy octal: up to three digits while the value fits a byte.
+        uint32_t value = static_cast<uint32_t>(c - '0');
+        for (size_t digits = 1; digits < 3 && p < end && *p >= '0' && *p <= '7'; ++digits) {
+            if (value * 8 + (*p - '0') > 0xFF) break;
+            value = value * 8 + (*p++ - '0');
         }
-        if (std::regex_search(remaining, match, templateStringRegex) && match.position() == 0) {
-            tokens.push_back({ TokenType::STRING, match.str() });
-            pos += match.length();
+        appendUtf8(out, value);
+        return p;
+    }
+    uint32_t codePoint;
+    size_t length = decodeUtf8(p - 1, end, codePoint);
+    if (length > 1) {
+        // U+2028 and U+2029 continue the line too; anything else is itself.
+        if (codePoint != 0x2028 && codePoint != 0x2029) out.append(p - 1, length);
+        return p - 1 + length;
+    }
+    appendUtf8(out, static_cast<uint8_t>(c));
+    return p;
+}
+
+} // namespace
+
+size_t decodeUtf8(const char* p, const char* end, uint32_t& codePoint) {
+    uint8_t lead = static_cast<uint8_t>(*p);
+    if (lead < 0x80) {
+        codePoint = lead;
+        return 1;
+    }
+    size_t length = lead >= 0xC2 && lead <= 0xDF ? 2 : lead >= 0xE0 && lead <= 0xEF ? 3
+                    : lead >= 0xF0 && lead <= 0xF4 ? 4 : 0;
+    if (length == 0 || static_cast<size_t>(end - p) < length) return 0;
+    uint32_t value = lead & (0x7F >> length);
+    for (size_t i = 1; i < length; ++i) {
+        uint8_t next = static_cast<uint8_t>(p[i]);
+        if ((next & 0xC0) != 0x80) return 0;
+        value = value << 6 | (next & 0x3F);
+    }
+    // Overlong forms and values past U+10FFFF.
+    if ((length == 3 && value < 0x800) || (length == 4 && (value < 0x10000 || value > 0x10FFFF))) return 0;
+    codePoint = value;
+    return length;
+}
+
+void appendStringValue(std::string& out, std::string_view literal) {
+    if (literal.size() >= 2 && (literal.front() == '"' || literal.front() == '\'') && literal.back() == literal.front()) {
+        literal = literal.substr(1, literal.size() - 2);
+    }
+    const char* p = literal.data();
+    const char* end = p + literal.size();
+    while (p < end) {
+        if (*p == '\\' && p + 1 < end) {
+            p = appendEscape(out, p + 1, end);
             continue;
         }
-        if (std::regex_search(remaining, match, operatorRegex) && match.position() == 0) {
-            tokens.push_back({ TokenType::OPERATOR, match.str() });
-            pos += match.length();
-            continue;
+        uint32_t codePoint;
+        size_t length = decodeUtf8(p, end, codePoint);
+        if (length == 0) {
+            appendUtf8(out, static_cast<uint8_t>(*p));
+            ++p;
+        } else {
+            out.append(p, length);
+            p += length;
         }
-        if (std::regex_search(remaining, match, symbolRegex) && match.position() == 0) {
-            tokens.push_back({ TokenType::SYMBOL, match.str() });
-            pos += match.length();
+    }
+}
+
+Lexer::Lexer(std::string_view source, AtomTable& atomTable) : sourceCode(source), atoms(atomTable) {
+    if (source.size() > UINT32_MAX) {
+        throw std::length_error("Source exceeds 4 GiB token offset range");
+    }
+}
+
+TokenStream Lexer::tokenize() {
+    TokenStream tokens;
+    tokenize(tokens);
+    return tokens;
+}
+
+void Lexer::tokenize(TokenStream& tokens) {
+    tokens.reset(sourceCode);
+    position = 0;
+    if (lineStarts) lineStarts->assign(1, 0);
+    // One batch normally covers the whole source; dense input takes more.
+    const size_t batch = sourceCode.size() / 4 + 16;
+    for (;;) {
+        size_t used = tokens.size();
+        size_t filled = fill(tokens.extend(batch), batch);
+        tokens.truncate(used + filled);
+        if (filled < batch) break;
+    }
+}
+
+void Lexer::recordLineStarts(std::vector<uint32_t>* starts) {
+    lineStarts = starts;
+    if (starts) starts->assign(1, 0);
+}
+
+// Line breaks only occur in whitespace and, unescaped, in a string literal
+// the lexer let through, so those are the only tokens searched for them.
+void Lexer::recordLines(const char* from, const char* to) {
+    const char* begin = sourceCode.data();
+    while ((from = static_cast<const char*>(std::memchr(from, '\n', static_cast<size_t>(to - from)))) != nullptr) {
+        ++from;
+        lineStarts->push_back(static_cast<uint32_t>(from - begin));
+    }
+}
+
+size_t Lexer::fill(const TokenSlots& out, size_t max) {
+    const char* const begin = sourceCode.data();
+    const char* const end = begin + sourceCode.size();
+    const char* p = begin + position;
+    const ScanKernels& scan = scanKernels();
+    size_t count = 0;
+
+    while (count < max && p < end) {
+        TokenType type = TokenType::SYMBOL;
+        Atom atom = INVALID_ATOM;
+        size_t length = 0;
+
+        switch (charClass(*p)) {
+            case CC_SPACE: {
+                const char* run = p++;
+                if (p < end && charClass(*p) == CC_SPACE) {
+                    OBF_STAT(++stats.whitespaceRuns;)
+                    p = scan.skipWhitespace(p, end);
+                }
+                if (lineStarts) recordLines(run, p);
+                continue;
+            }
+            case CC_IDENT_START:
+                length = scanIdentifier(scan, p, end);
+                atom = keywordAtom(std::string_view(p, length));
+                type = atom != INVALID_ATOM ? TokenType::KEYWORD : TokenType::IDENTIFIER;
+                break;
+            case CC_DIGIT:
+                length = scanNumber(p, end);
+                type = TokenType::NUMBER;
+                break;
+            case CC_QUOTE:
+                length = scanQuoted(scan, p, end);
+                type = TokenType::STRING;
+                if (lineStarts) recordLines(p, p + length);
+                break;
+            case CC_OPERATOR:
+                length = scanOperator(p, end);
+                type = TokenType::OPERATOR;
+                break;
+            case CC_SYMBOL:
+                length = 1;
+                type = TokenType::SYMBOL;
+                break;
+            default:
+                break;
+        }
+
+        if (length == 0) {
+            OBF_STAT(++stats.unknownTokens;)
+            std::cerr << "Unknown token: " << *p << std::endl;
+            ++p;
             continue;
         }
 
-        std::cerr << "Unknown token: " << sourceCode[pos] << std::endl;
-        pos++;
+        OBF_STAT(++stats.tokens[static_cast<size_t>(type)];)
+        out.types[count] = type;
+        out.atoms[count] = atom != INVALID_ATOM ? atom : atoms.intern(std::string_view(p, length));
+        out.offsets[count] = static_cast<uint32_t>(p - begin);
+        out.lengths[count] = static_cast<uint32_t>(length);
+        ++count;
+        p += length;
     }
+    position = static_cast<size_t>(p - begin);
+    return count;
+}
 
-    return tokens;
+size_t TokenStreamSource::fill(const TokenSlots& out, size_t max) {
+    size_t count = std::min(max, tokens.size() - next);
+    for (size_t i = 0; i < count; ++i, ++next) {
+        out.types[i] = tokens.type(next);
+        out.atoms[i] = tokens.atom(next);
+        out.offsets[i] = tokens.offset(next);
+        out.lengths[i] = tokens.length(next);
+    }
+    return count;
 }
@@ -4,72 +4,421 @@
  * @Last Modified by:   Cuersy 
  * @Last Modified time: 2025-10-10 18:12:14 
  */
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
-#include <fstream>
-#include <vector>
-#include "lexer.h"
-#include "parser.h"
-#include "obfuscator.h"
-
-void printAST(const std::shared_ptr<ASTNode>& node, int indent = 0) {
-    if (!node) return;
-
-    for (int i = 0; i < indent; ++i) std::cout << "  ";
-    std::cout << "ASTNodeType: ";
-    switch (node->type) {
-        case ASTNodeType::PROGRAM: std::cout << "Program"; break;
-        case ASTNodeType::BLOCK: std::cout << "Block"; break;
-        case ASTNodeType::IF_STATEMENT: std::cout << "IfStatement"; break;
-        case ASTNodeType::WHILE_STATEMENT: std::cout << "WhileStatement"; break;
-        case ASTNodeType::VARIABLE_DECLARATION: std::cout << "VariableDeclaration"; break;
-        case ASTNodeType::FUNCTION_DECLARATION: std::cout << "FunctionDeclaration"; break;
-        case ASTNodeType::STRING: std::cout << "String"; break;
-        case ASTNodeType::FUNCTION_CALL: std::cout << "FuncCall"; break;
-        case ASTNodeType::RETURN_STATEMENT: std::cout << "ReturnStatement"; break;
-        case ASTNodeType::EXPRESSION: std::cout << "Expression"; break;
-        case ASTNodeType::NUMBER: std::cout << "Number"; break;
-        case ASTNodeType::BINARY_EXPRESSION: std::cout << "BINARY EXPRESSION"; break;
-        case ASTNodeType::IDENTIFIER: std::cout << "Identifier"; break;
-        case ASTNodeType::MEMBER_EXPRESSION: std::cout << "MemberExpression"; break;
-        default: std::cout << "Unknown"; break;
-    }
-    std::cout << ", Value: \"" << node->value << "\"" << std::endl;
-
-    for (const auto& child : node->children) {
-        printAST(child, indent + 1);
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include "ast_file.h"
+#include "batch.h"
+#include "file_io.h"
+#include "pass_manager.h"
+#include "pipeline.h"
+#include "result_cache.h"
+#include "server.h"
+#include "source_map.h"
+#include "stats.h"
+#include "thread_pool.h"
+
+// Prints one line per node, indented two spaces per level; EMPTY placeholders and
+// their subtrees are left out.
+class ASTPrinter {
+public:
+    static constexpr NodeTypeMask kVisits = kAllNodeTypes;
+
+    ASTPrinter(std::ostream& out, const AST& ast, const AtomTable& atoms) : out(out), ast(ast), atoms(atoms) {}
+
+    bool enter(NodeId id, NodeId) {
+        const ASTNode& node = ast[id];
+        if (node.type == ASTNodeType::EMPTY) return false;
+        out.write(indent.data(), static_cast<std::streamsize>(indent.size()));
+        indent += "  ";
+        out << "ASTNodeType: ";
+        switch (node.type) {
+            case ASTNodeType::PROGRAM: out << "Program"; break;
+            case ASTNodeType::BLOCK: out << "Block"; break;
+            case ASTNodeType::IF_STATEMENT: out << "IfStatement"; break;
+            case ASTNodeType::WHILE_STATEMENT: out << "WhileStatement"; break;
+            case ASTNodeType::VARIABLE_DECLARATION: out << "VariableDeclaration"; break;
+            case ASTNodeType::FUNCTION_DECLARATION: out << "FunctionDeclaration"; break;
+            case ASTNodeType::STRING: out << "String"; break;
+            case ASTNodeType::FUNCTION_CALL: out << "FuncCall"; break;
+            case ASTNodeType::RETURN_STATEMENT: out << "ReturnStatement"; break;
+            case ASTNodeType::EXPRESSION: out << "Expression"; break;
+            case ASTNodeType::NUMBER: out << "Number"; break;
+            case ASTNodeType::BINARY_EXPRESSION: out << "BINARY EXPRESSION"; break;
+            case ASTNodeType::UNARY_EXPRESSION: out << "UnaryExpression"; break;
+            case ASTNodeType::POSTFIX_EXPRESSION: out << "PostfixExpression"; break;
+            case ASTNodeType::CONDITIONAL_EXPRESSION: out << "ConditionalExpression"; break;
+            case ASTNodeType::IDENTIFIER: out << "Identifier"; break;
+            case ASTNodeType::MEMBER_EXPRESSION: out << "MemberExpression"; break;
+            default: out << "Unknown"; break;
+        }
+        out << ", Value: \"" << atoms.str(node.value) << "\"\n";
+        return true;
     }
+    void leave(NodeId id, NodeId) {
+        if (ast[id].type != ASTNodeType::EMPTY) indent.resize(indent.size() - 2);
+    }
+
+private:
+    std::ostream& out;
+    const AST& ast;
+    const AtomTable& atoms;
+    std::string indent;
+};
+
+void printAST(std::ostream& out, const AST& ast, const AtomTable& atoms, NodeId root) {
+    ASTPrinter printer(out, ast, atoms);
+    PassManager<ASTPrinter>(printer).run(ast, root);
+}
+
+// Default output location: output.js next to the input, or stdout for stdin.
+std::string defaultOutputPath(const std::string& inputPath) {
+    if (inputPath == "-") return "-";
+    size_t slash = inputPath.find_last_of("/\\");
+    return slash == std::string::npos ? "output.js" : inputPath.substr(0, slash + 1) + "output.js";
+}
+
+// True when both paths name one existing file, however they are spelled.
+bool sameFile(const std::string& a, const std::string& b) {
+    if (a == "-" || b == "-") return false;
+    std::error_code ec;
+    return std::filesystem::equivalent(a, b, ec);
+}
+
+void printUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [-j <threads>] [--strings <encoding>] [--names <style>] [--compact] [--source-map] [--dump-ast] [--save-ast <file.ast>] [-o <output.js>] <input.js>\n"
+              << "       " << argv0 << " --load-ast <file.ast> [-j <threads>] [--strings <encoding>] [--names <style>] [--compact] [--source-map] [--dump-ast] [-o <output.js>]\n"
+              << "       " << argv0 << " --batch [-j <threads>] [--strings <encoding>] [--names <style>] [--compact] [--source-map] [--out-dir <dir>] <file|dir|@manifest>...\n"
+              << "       " << argv0 << " --serve <socket> [-j <threads>] [--max-request <MiB>] [--strings <encoding>] [--names <style>] [--compact]\n"
+              << "       " << argv0 << " --client <socket> [-o <output.js>] <input.js>\n"
+              << "  Use '-' as input or output path for stdin/stdout.\n"
+              << "  Batch mode writes <name>.obf.js next to each input, or under --out-dir.\n"
+              << "  --cache-dir <dir>    reuse results for unchanged inputs\n"
+              << "  --cache-size <MiB>   evict least recently used results beyond this size (default 512)\n"
+              << "  --max-request <MiB>  largest request the server accepts (default 256)\n"
+              << "  --stats[=text|json]  print phase timings and counters to stderr\n"
+              << "  --compact            no indentation, line breaks or optional spaces\n"
+              << "  --source-map         also write a v3 source map to <output>.map\n"
+              << "  --dump-ast           print the obfuscated AST before writing the code\n"
+              << "  --save-ast <path>    also write the parsed AST, for later runs with --load-ast\n"
+              << "  --load-ast <path>    obfuscate an AST saved by --save-ast instead of parsing source\n"
+              << "  --strings <encoding> string table encoding, smallest to strongest: shuffle, base64,\n"
+              << "                       xor; or hex (the default)\n"
+              << "  --names <style>      renamed identifiers: short (per scope, most used shortest,\n"
+              << "                       globals kept) or hex (the default)" << std::endl;
+}
+
+enum class StatsFormat { NONE, TEXT, JSON };
+
+int finish(int status, StatsFormat statsFormat, RunStats* stats) {
+#if CURSIOBFUSCATOR_STATS
+    if (stats && statsFormat != StatsFormat::NONE) {
+        stats->stopTotal();
+        printStats(std::cerr, *stats, statsFormat == StatsFormat::JSON);
+    }
+#else
+    (void)statsFormat;
+    (void)stats;
+#endif
+    return status;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <input.js>" << std::endl;
+    std::string outputPath;
+    bool batch = false;
+    BatchOptions batchOptions;
+    std::string cacheDir;
+    uintmax_t cacheSize = ResultCache::kDefaultMaxBytes;
+    StatsFormat statsFormat = StatsFormat::NONE;
+    std::string serveSocket;
+    std::string clientSocket;
+    uint64_t maxRequestBytes = 0;
+    bool obfuscatorOptionsSet = false;
+    bool dumpAST = false;
+    std::string saveASTPath;
+    std::string loadASTPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "--batch") {
+            batch = true;
+        } else if (arg == "--out-dir" && i + 1 < argc) {
+            batchOptions.outDir = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            char* end = nullptr;
+            unsigned long threads = std::strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || threads == 0) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            batchOptions.threads = threads;
+        } else if (arg == "--cache-dir" && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (arg == "--cache-size" && i + 1 < argc) {
+            char* end = nullptr;
+            unsigned long long mebibytes = std::strtoull(argv[++i], &end, 10);
+            if (*end != '\0') {
+                printUsage(argv[0]);
+                return 1;
+            }
+            cacheSize = static_cast<uintmax_t>(mebibytes) << 20;
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serveSocket = argv[++i];
+        } else if (arg == "--max-request" && i + 1 < argc) {
+            char* end = nullptr;
+            unsigned long long mebibytes = std::strtoull(argv[++i], &end, 10);
+            // The lexer's 32-bit offsets cap requests below 4 GiB.
+            if (*end != '\0' || mebibytes == 0 || mebibytes >= 4096) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            maxRequestBytes = static_cast<uint64_t>(mebibytes) << 20;
+        } else if (arg == "--client" && i + 1 < argc) {
+            clientSocket = argv[++i];
+        } else if (arg == "--strings" && i + 1 < argc) {
+            if (!parseStringEncoding(argv[++i], batchOptions.obfuscator.strings)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            obfuscatorOptionsSet = true;
+        } else if (arg == "--names" && i + 1 < argc) {
+            if (!parseNameStyle(argv[++i], batchOptions.obfuscator.names)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            obfuscatorOptionsSet = true;
+        } else if (arg == "--compact") {
+            batchOptions.obfuscator.compact = true;
+            obfuscatorOptionsSet = true;
+        } else if (arg == "--source-map") {
+            batchOptions.sourceMaps = true;
+        } else if (arg == "--dump-ast") {
+            dumpAST = true;
+        } else if (arg == "--save-ast" && i + 1 < argc) {
+            saveASTPath = argv[++i];
+        } else if (arg == "--load-ast" && i + 1 < argc) {
+            loadASTPath = argv[++i];
+        } else if (arg == "--stats" || arg == "--stats=text") {
+            statsFormat = StatsFormat::TEXT;
+        } else if (arg == "--stats=json") {
+            statsFormat = StatsFormat::JSON;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            batchOptions.inputs.push_back(arg);
+        }
+    }
+    RunStats* stats = nullptr;
+#if CURSIOBFUSCATOR_STATS
+    RunStats runStats;
+    if (statsFormat != StatsFormat::NONE) {
+        stats = &runStats;
+        stats->startTotal();
+    }
+#else
+    if (statsFormat != StatsFormat::NONE) {
+        std::cerr << "Error: --stats is not available; this build has CURSIOBFUSCATOR_STATS disabled" << std::endl;
+        return 1;
+    }
+#endif
+    batchOptions.stats = stats;
+
+    std::unique_ptr<ResultCache> cache;
+    if (!cacheDir.empty()) {
+        cache = std::make_unique<ResultCache>(cacheDir, cacheSize, batchOptions.obfuscator.key());
+        batchOptions.cache = cache.get();
+    }
+
+    // Trees are only parsed, loaded and dumped by single-file runs in this process.
+    bool astOptions = dumpAST || !saveASTPath.empty() || !loadASTPath.empty();
+    if (!serveSocket.empty()) {
+        // Clients send their sources over the socket; results go back the same way.
+        if (batch || !clientSocket.empty() || stats || astOptions || !outputPath.empty() ||
+            !batchOptions.inputs.empty() || !batchOptions.outDir.empty() || batchOptions.sourceMaps) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        ServerOptions serverOptions;
+        serverOptions.socketPath = serveSocket;
+        serverOptions.threads = batchOptions.threads;
+        serverOptions.obfuscator = batchOptions.obfuscator;
+        serverOptions.cache = cache.get();
+        if (maxRequestBytes) serverOptions.maxRequestBytes = maxRequestBytes;
+        return runServer(serverOptions);
+    }
+    if (maxRequestBytes) {
+        printUsage(argv[0]);
         return 1;
     }
-    std::ifstream file(argv[1]);
-    if (!file.is_open()) {
-        std::cerr << "Error: Cannot open file " << argv[1] << std::endl;
+    // The server owns the cache and the options and does all the work for a client.
+    if (!clientSocket.empty() &&
+        (batch || cache || stats || astOptions || obfuscatorOptionsSet || batchOptions.sourceMaps)) {
+        printUsage(argv[0]);
         return 1;
     }
-    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    file.close();
-    Lexer lexer(source);
-    std::vector<Token> tokens = lexer.tokenize();
-    Parser parser(tokens);
-    auto ast = parser.parseProgram();
-    Obfuscator obfuscator;
-    obfuscator.obfuscate(ast);
-    std::cout << "=== Obfuscated AST === \\\\||" << std::endl;
-    printAST(ast);
-    std::string obfuscatedCode = obfuscator.generateObfuscatedCode(ast);
-    std::ofstream outFile("../test/output.js");
-    if (!outFile.is_open()) {
-        std::cerr << "Error: Cannot open output.js for writing" << std::endl;
+    // Cached results carry no map to go with them, and skip the parse whose
+    // tree --save-ast writes.
+    if (cache && (batchOptions.sourceMaps || !saveASTPath.empty())) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (batch) {
+        // stdin and -o only make sense for a single file.
+        bool usesStdin = std::find(batchOptions.inputs.begin(), batchOptions.inputs.end(), "-") != batchOptions.inputs.end();
+        if (!outputPath.empty() || usesStdin || batchOptions.inputs.empty() || astOptions) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return finish(runBatch(batchOptions), statsFormat, stats);
+    }
+    // An AST file takes the place of the source.
+    if (!loadASTPath.empty()) {
+        if (!batchOptions.inputs.empty() || !saveASTPath.empty()) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        batchOptions.inputs.push_back(loadASTPath);
+    }
+    if (batchOptions.inputs.size() != 1 || !batchOptions.outDir.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    const std::string& inputPath = batchOptions.inputs[0];
+    if (outputPath.empty()) outputPath = defaultOutputPath(inputPath);
+    // The input is still mapped while the output is written, and overwriting
+    // it loses the source; output.js is a likely input name.
+    for (const std::string* path : { &outputPath, &saveASTPath }) {
+        if (sameFile(inputPath, *path)) {
+            std::cerr << "Error: Refusing to overwrite the input file " << *path << std::endl;
+            return 1;
+        }
+    }
+    // The map is written next to the output file.
+    if (batchOptions.sourceMaps && (outputPath == "-" || inputPath == "-")) {
+        printUsage(argv[0]);
         return 1;
     }
-    outFile << obfuscatedCode;
-    outFile.close();
 
-    std::cout << "Obfuscated code written to output.js" << std::endl;
+    // Keep stdout clean for the generated code when it is the output stream.
+    std::ostream& info = outputPath == "-" ? std::cerr : std::cout;
 
-    return 0;
-}
\ No newline at end of file
+    InputFile input;
+    {
+        OBF_STAT(PhaseTimer timer(stats, PHASE_READ);)
+        if (!input.open(inputPath)) {
+            std::cerr << "Error: Cannot open file " << inputPath << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+    OBF_STAT(if (stats) stats->files = 1;)
+    if (!clientSocket.empty()) {
+        std::string obfuscatedCode;
+        if (!requestObfuscation(clientSocket, input.data(), obfuscatedCode)) return 1;
+        if (!writeOutput(outputPath, obfuscatedCode)) {
+            std::cerr << "Error: Cannot write " << outputPath << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        info << "Obfuscated code written to " << (outputPath == "-" ? "stdout" : outputPath) << std::endl;
+        return 0;
+    }
+    std::string cacheKey;
+    if (cache) {
+        cacheKey = cache->key(input.data());
+        InputFile cached;
+        if (cache->lookup(cacheKey, cached)) {
+            {
+                OBF_STAT(PhaseTimer timer(stats, PHASE_WRITE);)
+                if (!writeOutput(outputPath, cached.data())) {
+                    std::cerr << "Error: Cannot write " << outputPath << ": " << std::strerror(errno) << std::endl;
+                    return 1;
+                }
+            }
+            OBF_STAT(if (stats) {
+                stats->cacheHits = 1;
+                stats->bytesIn = input.data().size();
+                stats->bytesOut = cached.data().size();
+            })
+            info << "Obfuscated code written to " << (outputPath == "-" ? "stdout" : outputPath)
+                 << " (from cache)" << std::endl;
+            return finish(0, statsFormat, stats);
+        }
+    }
+    // Large programs are renamed and emitted in parallel across their
+    // top-level statements.
+    ThreadPool pool(batchOptions.threads);
+    ObfuscationContext context(&pool, batchOptions.obfuscator);
+    SourceMap sourceMap;
+    SourceMap* map = batchOptions.sourceMaps ? &sourceMap : nullptr;
+    if (!loadASTPath.empty()) {
+        ASTFileSource source;
+        std::string error;
+        if (!context.load(input.data(), source, error, stats)) {
+            std::cerr << "Error: Cannot load " << inputPath << ": " << error << std::endl;
+            return 1;
+        }
+        if (map) {
+            // The map points at the source the tree was parsed from.
+            if (source.path.empty()) {
+                std::cerr << "Error: " << inputPath << " was saved from stdin and cannot have a source map" << std::endl;
+                return 1;
+            }
+            sourceMap.setPaths(source.path, outputPath);
+            sourceMap.lines.reset(std::move(source.lineStarts));
+        }
+    } else {
+        context.parse(input.data(), stats, map ? &sourceMap.lines : nullptr);
+        if (!saveASTPath.empty()) {
+            // Saved with an absolute path, so a map made from it later finds
+            // the source from anywhere.
+            std::string sourcePath;
+            std::error_code ec;
+            if (inputPath != "-") sourcePath = std::filesystem::absolute(inputPath, ec).generic_string();
+            std::string saved;
+            context.save(input.data(), sourcePath, saved);
+            if (!writeOutput(saveASTPath, saved)) {
+                std::cerr << "Error: Cannot write " << saveASTPath << ": " << std::strerror(errno) << std::endl;
+                return 1;
+            }
+        }
+        if (map) sourceMap.setPaths(inputPath, outputPath);
+    }
+    AstInspector dump;
+    if (dumpAST) {
+        dump = [&info](const AST& ast, const AtomTable& atoms) {
+            info << "=== Obfuscated AST === \\\\||\n";
+            printAST(info, ast, atoms, ast.root());
+            info.flush();
+        };
+    }
+    context.obfuscate(dump, stats, map);
+    std::string obfuscatedCode = context.takeOutput();
+    {
+        OBF_STAT(PhaseTimer timer(stats, PHASE_WRITE);)
+        if (!writeOutput(outputPath, obfuscatedCode)) {
+            std::cerr << "Error: Cannot write " << outputPath << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        if (batchOptions.sourceMaps && !writeOutput(outputPath + ".map", sourceMap.toJson())) {
+            std::cerr << "Error: Cannot write " << outputPath << ".map: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+    if (cache) {
+        cache->store(cacheKey, obfuscatedCode);
+        cache->evict();
+    }
+
+    info << "Obfuscated code written to " << (outputPath == "-" ? "stdout" : outputPath) << std::endl;
+
+    return finish(0, statsFormat, stats);
+}
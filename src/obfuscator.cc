@@ -5,12 +5,248 @@
  * @Last Modified time: 2025-10-10 18:12:16 
  */
 #include "obfuscator.h"
+#include <algorithm>
+#include <numeric>
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include "hash.h"
+#include "lexer.h"
+#include "pass_manager.h"
+#include "thread_pool.h"
 
-Obfuscator::Obfuscator() : nameCounter(0), stringCounter(0) {
-    reservedNames = {"console", "log"};
+namespace {
+
+// Below this many nodes a program is handled on the calling thread; task
+// overhead would outweigh the walk itself.
+constexpr size_t kParallelMinNodes = 1 << 16;
+// Top-level chunks per pool thread, so stealing can even out statements of
+// very different sizes.
+constexpr size_t kChunksPerThread = 4;
+
+// Bits in the per-chunk seen table.
+constexpr uint8_t kSeenName = 1;
+constexpr uint8_t kSeenNumber = 2;
+constexpr uint8_t kSeenString = 4;
+constexpr uint8_t kSeenMember = 8;
+
+// A string read this often in one scope is decoded once into a local at
+// the scope's entry instead of through the accessor at every use.
+constexpr uint32_t kMinCachedUses = 2;
+
+// Grows a per-atom table so that index atom is addressable.
+void ensureSlot(std::vector<Atom>& table, Atom atom) {
+    if (atom >= table.size()) table.resize(atom + 1, INVALID_ATOM);
+}
+
+// Records atom in list the first time it is seen with this flag.
+void noteFirst(std::vector<Atom>& list, std::vector<uint8_t>& seen, Atom atom, uint8_t flag) {
+    if (seen[atom] & flag) return;
+    seen[atom] |= flag;
+    list.push_back(atom);
+}
+
+// Node types whose children the generator emits; everything else is skipped
+// during code generation along with its subtree.
+constexpr NodeTypeMask kEmittedChildren =
+    nodeTypes(ASTNodeType::PROGRAM, ASTNodeType::FUNCTION_DECLARATION, ASTNodeType::BLOCK,
+              ASTNodeType::RETURN_STATEMENT, ASTNodeType::FUNCTION_CALL, ASTNodeType::MEMBER_EXPRESSION,
+              ASTNodeType::EXPRESSION, ASTNodeType::BINARY_EXPRESSION, ASTNodeType::UNARY_EXPRESSION,
+              ASTNodeType::POSTFIX_EXPRESSION, ASTNodeType::CONDITIONAL_EXPRESSION);
+// Types the parser never gives children.
+constexpr NodeTypeMask kLeaves =
+    nodeTypes(ASTNodeType::IDENTIFIER, ASTNodeType::NUMBER, ASTNodeType::STRING, ASTNodeType::EMPTY);
+// Passes that follow what the generator emits stop at these.
+constexpr NodeTypeMask kHiddenSubtrees = ~(kEmittedChildren | kLeaves);
+
+// Expressions other than calls, which end their own statements.
+bool isPlainExpression(ASTNodeType type) {
+    switch (type) {
+        case ASTNodeType::MEMBER_EXPRESSION:
+        case ASTNodeType::EXPRESSION:
+        case ASTNodeType::IDENTIFIER:
+        case ASTNodeType::NUMBER:
+        case ASTNodeType::STRING:
+        case ASTNodeType::BINARY_EXPRESSION:
+        case ASTNodeType::UNARY_EXPRESSION:
+        case ASTNodeType::POSTFIX_EXPRESSION:
+        case ASTNodeType::CONDITIONAL_EXPRESSION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// How tightly the code generated for a node binds, which decides whether it
+// needs parentheses as an operand.
+uint8_t precedenceOf(const ASTNode& node) {
+    switch (node.type) {
+        case ASTNodeType::EXPRESSION:
+        case ASTNodeType::BINARY_EXPRESSION:
+            return binaryPrecedence(node.value);
+        case ASTNodeType::CONDITIONAL_EXPRESSION:
+            return PREC_CONDITIONAL;
+        case ASTNodeType::UNARY_EXPRESSION:
+            return PREC_PREFIX;
+        case ASTNodeType::POSTFIX_EXPRESSION:
+            return PREC_POSTFIX;
+        default:
+            return PREC_PRIMARY;
+    }
+}
+
+// The operator character the code for node starts with, if it starts with
+// a prefix operator, or 0. Looks through the left operands that come first,
+// even where they end up parenthesized, so it may report one that is not
+// there.
+char leadingOperator(const AST& ast, NodeId id) {
+    while (id != INVALID_NODE) {
+        const ASTNode& node = ast[id];
+        switch (node.type) {
+            case ASTNodeType::EXPRESSION:
+            case ASTNodeType::BINARY_EXPRESSION:
+            case ASTNodeType::POSTFIX_EXPRESSION:
+            case ASTNodeType::CONDITIONAL_EXPRESSION:
+                id = node.firstChild;
+                break;
+            case ASTNodeType::UNARY_EXPRESSION:
+                return node.value == ATOM_NOT ? '!' : node.value == ATOM_BIT_NOT ? '~'
+                       : node.value == ATOM_PLUS || node.value == ATOM_INCREMENT ? '+' : '-';
+            default:
+                return 0;
+        }
+    }
+    return 0;
+}
+
+// Whitespace of the generated code. The generator is a template over one
+// of these, so each layout is compiled on its own and the pretty one pays
+// nothing for the other.
+struct PrettyLayout {
+    // Before a statement at the given nesting depth.
+    static void indent(std::string& out, int depth) { out.append(depth * 2, ' '); }
+    // After a statement or an opening brace.
+    static void newline(std::string& out) { out += '\n'; }
+    // Around operators and before braces, where the syntax does not need it.
+    static void space(std::string& out) { out += ' '; }
+    // Before a closing brace.
+    static void closeBlock(std::string&) {}
+};
+
+// Only the whitespace the syntax needs. Every statement still ends with a
+// semicolon, so no line break is ever needed for automatic semicolon
+// insertion; the one before a closing brace is dropped.
+struct CompactLayout {
+    static void indent(std::string&, int) {}
+    static void newline(std::string&) {}
+    static void space(std::string&) {}
+    static void closeBlock(std::string& out) {
+        if (!out.empty() && out.back() == ';') out.pop_back();
+    }
+};
+
+} // namespace
+
+namespace {
+
+constexpr const char* kStringEncodingNames[] = { "hex", "shuffle", "base64", "xor" };
+constexpr const char* kNameStyleNames[] = { "hex", "short" };
+
+constexpr uint32_t kNoBinding = UINT32_MAX;
+
+// Short names never start with '_', so they cannot meet the _0x names of
+// the string table and its cached locals.
+constexpr std::string_view kShortNameFirst = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ$";
+constexpr std::string_view kShortNameRest =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ$0123456789_";
+
+// Words a short name must not spell: reserved words, and the globals the
+// string-table decoders read from inside the program scope.
+constexpr std::string_view kUnavailableNames[] = {
+    "do", "if", "in", "of", "as", "for", "let", "new", "try", "var", "NaN", "case", "else", "enum",
+    "eval", "null", "this", "true", "void", "with", "atob", "async", "await", "break", "catch", "class",
+    "const", "false", "super", "throw", "while", "yield", "delete", "export", "import", "public",
+    "return", "static", "String", "switch", "typeof", "default", "extends", "finally", "package",
+    "private", "continue", "debugger", "function", "Infinity", "arguments", "interface", "protected",
+    "undefined", "implements", "instanceof"
+};
+
+// The n-th name in order of length: a..$, then aa, ba, ...
+std::string shortName(size_t n) {
+    std::string name(1, kShortNameFirst[n % kShortNameFirst.size()]);
+    n /= kShortNameFirst.size();
+    while (n > 0) {
+        --n;
+        name += kShortNameRest[n % kShortNameRest.size()];
+        n /= kShortNameRest.size();
+    }
+    return name;
+}
+
+bool isUnavailableName(std::string_view name) {
+    for (std::string_view word : kUnavailableNames) {
+        if (word == name) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+bool parseStringEncoding(std::string_view name, StringEncoding& encoding) {
+    for (size_t i = 0; i < sizeof(kStringEncodingNames) / sizeof(kStringEncodingNames[0]); ++i) {
+        if (name == kStringEncodingNames[i]) {
+            encoding = static_cast<StringEncoding>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* stringEncodingName(StringEncoding encoding) {
+    return kStringEncodingNames[static_cast<size_t>(encoding)];
+}
+
+bool parseNameStyle(std::string_view name, NameStyle& style) {
+    for (size_t i = 0; i < sizeof(kNameStyleNames) / sizeof(kNameStyleNames[0]); ++i) {
+        if (name == kNameStyleNames[i]) {
+            style = static_cast<NameStyle>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* nameStyleName(NameStyle style) {
+    return kNameStyleNames[static_cast<size_t>(style)];
+}
+
+std::string ObfuscatorOptions::key() const {
+    return std::string("strings=") + stringEncodingName(strings) + " names=" + nameStyleName(names) +
+           (compact ? " compact" : "");
+}
+
+Obfuscator::Obfuscator(AtomTable& atomTable, ThreadPool* threadPool, const ObfuscatorOptions& obfuscatorOptions)
+    : atoms(atomTable), pool(threadPool), options(obfuscatorOptions), nameCounter(0), stringCounter(0) {
+    reservedNames.assign(ATOM_WELL_KNOWN_COUNT, false);
+    reservedNames[ATOM_CONSOLE] = true;
+    reservedNames[ATOM_LOG] = true;
+}
+
+void Obfuscator::reset() {
+    nameMap.clear();
+    numberMap.clear();
+    stringIndexMap.clear();
+    literalMap.clear();
+    stringList.clear();
+    nameCounter = 0;
+    stringCounter = 0;
+    scopedNames = 0;
+    scopedSources.clear();
+    scopedOriginals.clear();
+    stringFunc.clear();
+    cachedScopes.clear();
+    cachedIndices.clear();
+    readsCachedString.clear();
 }
 std::string obfstr(const std::string& input) {
     std::ostringstream oss;
@@ -25,198 +261,1209 @@ std::string Obfuscator::generateNewName() {
     return ss.str();
 }
 
-std::string Obfuscator::getObfuscatedName(const std::string& original) {
-    if (reservedNames.count(original)) {
+bool Obfuscator::isReserved(Atom name) const {
+    return name < reservedNames.size() && reservedNames[name];
+}
+
+Atom Obfuscator::getObfuscatedName(Atom original) {
+    if (isReserved(original)) {
         return original;
     }
-    if (nameMap.find(original) == nameMap.end()) {
-        nameMap[original] = generateNewName();
+    ensureSlot(nameMap, original);
+    if (nameMap[original] == INVALID_ATOM) {
+        nameMap[original] = atoms.intern(generateNewName());
     }
     return nameMap[original];
 }
 
-std::string Obfuscator::getStringIndex(const std::string& str) {
-    std::string cleanStr = str;
-    if (cleanStr.size() >= 2 && cleanStr.front() == '"' && cleanStr.back() == '"') {
-        cleanStr = cleanStr.substr(1, cleanStr.size() - 2);
+// Index of text in the string table, which it joins the first time.
+Atom Obfuscator::getStringIndex(Atom clean) {
+    ensureSlot(stringIndexMap, clean);
+    if (stringIndexMap[clean] == INVALID_ATOM) {
+        std::ostringstream index;
+        index << "0x" << std::hex << stringCounter++;
+        stringIndexMap[clean] = atoms.intern(index.str());
+        stringList.push_back(clean);
     }
-    if (stringTable.find(cleanStr) == stringTable.end()) {
-        stringTable[cleanStr] = stringCounter++;
-        stringList.push_back(cleanStr);
+    return stringIndexMap[clean];
+}
+
+// Only whole decimal integers are rewritten; fractions and exponents are
+// kept, and so are leading zeros, which make a legacy octal literal.
+Atom Obfuscator::obfuscateNumber(Atom num) {
+    ensureSlot(numberMap, num);
+    if (numberMap[num] == INVALID_ATOM) {
+        Atom result = num;
+        std::string text(atoms.str(num));
+        try {
+            size_t used = 0;
+            long value = std::stol(text, &used);
+            if (used == text.size() && (text.size() == 1 || text[0] != '0')) {
+                result = atoms.intern(std::to_string(value));
+            }
+        } catch (...) {
+        }
+        numberMap[num] = result;
     }
-    return "0x" + std::to_string(stringTable[cleanStr]);
+    return numberMap[num];
 }
 
-std::string Obfuscator::obfuscateNumber(const std::string& num) {
-    try {
-        long value = std::stol(num);
-        return std::to_string(value);
-    } catch (...) {
-        return num;
+// Splits the program's top-level statements into contiguous chunks. Returns
+// the first statement of each chunk followed by INVALID_NODE, so chunk i is
+// [starts[i], starts[i + 1]).
+std::vector<NodeId> Obfuscator::splitProgram(const AST& ast) const {
+    std::vector<NodeId> starts;
+    NodeId root = ast.root();
+    size_t units = root == INVALID_NODE ? 0 : ast[root].childCount;
+    if (units > 0) {
+        size_t chunks = 1;
+        if (pool && pool->size() > 1 && ast.size() >= kParallelMinNodes) {
+            chunks = std::min(units, pool->size() * kChunksPerThread);
+        }
+        size_t perChunk = (units + chunks - 1) / chunks;
+        size_t index = 0;
+        for (NodeId child = ast[root].firstChild; child != INVALID_NODE; child = ast[child].nextSibling) {
+            if (index++ % perChunk == 0) starts.push_back(child);
+        }
     }
+    starts.push_back(INVALID_NODE);
+    return starts;
 }
 
-void Obfuscator::obfuscateNode(std::shared_ptr<ASTNode> node) {
-    if (!node) return;
-    if (node->type == ASTNodeType::IDENTIFIER || 
-        node->type == ASTNodeType::FUNCTION_DECLARATION) {
-        node->value = getObfuscatedName(node->value);
-    } else if (node->type == ASTNodeType::NUMBER) {
-        node->value = obfuscateNumber(node->value);
-    } else if (node->type == ASTNodeType::STRING) {
-        node->value = getStringIndex(node->value);
-        node->type = ASTNodeType::STRING;
+void Obfuscator::forEachChunk(size_t count, const std::function<void(size_t)>& fn) {
+    if (!pool || count < 2) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
     }
-    for (auto& child : node->children) {
-        obfuscateNode(child);
+    for (size_t i = 0; i < count; ++i) {
+        pool->submit([&fn, i] { fn(i); });
     }
+    pool->wait();
 }
 
-void Obfuscator::obfuscate(std::shared_ptr<ASTNode> ast) {
-    obfuscateNode(ast);
+// A member whose object and property are both reserved is printed as-is
+// without emitting the object. Renaming never turns an atom into a
+// reserved one, so the answer is the same before and after rewriting.
+bool Obfuscator::isPlainMember(const AST& ast, NodeId member) const {
+    NodeId object = ast[member].firstChild;
+    return isReserved(ast[object].value) && isReserved(ast[ast[object].nextSibling].value);
 }
 
-std::string Obfuscator::generateStringTable(std::string& funcName) {
-    std::string tableName = generateNewName();
-    funcName = generateNewName();
-    std::stringstream ss;
-    ss << "var " << tableName << "=['";
-    for (size_t i = 0; i < stringList.size(); ++i) {
-        if (i > 0) ss << "','";
-        for (char c : stringList[i]) {
-            if (c == '\'') ss << "\\'";
-            else if (c == '\\') ss << "\\\\";
-            else if (c == '\n') ss << "\\n";
-            else if (c == '\t') ss << "\\t";
-            else ss << "\\x" << std::hex << std::setw(2) << std::setfill('0') << (static_cast<int>(c) & 0xFF);
-        }
-    }
-    ss << "'];";
-    ss << "var " << funcName << "=function(_0x1){return " << tableName << "[_0x1];};";
-    return ss.str();
+// Lists the atoms a chunk needs names, numbers and string indices for.
+// Read-only, so chunks can run concurrently.
+class Obfuscator::RefCollector {
+public:
+    static constexpr NodeTypeMask kVisits = nodeTypes(ASTNodeType::IDENTIFIER, ASTNodeType::FUNCTION_DECLARATION,
+                                                      ASTNodeType::NUMBER, ASTNodeType::STRING);
+
+    RefCollector(const Obfuscator& obfuscator, const AST& ast, ChunkRefs& refs, std::vector<uint8_t>& seen)
+        : obfuscator(obfuscator), ast(ast), refs(refs), seen(seen) {}
+
+    bool enter(NodeId id, NodeId) {
+        const ASTNode& node = ast[id];
+        if (node.type == ASTNodeType::NUMBER) {
+            noteFirst(refs.numbers, seen, node.value, kSeenNumber);
+        } else if (node.type == ASTNodeType::STRING) {
+            noteFirst(refs.strings, seen, node.value, kSeenString);
+        } else if (obfuscator.options.names == NameStyle::HEX && !obfuscator.isReserved(node.value)) {
+            noteFirst(refs.names, seen, node.value, kSeenName);
+        }
+        return true;
+    }
+    void leave(NodeId, NodeId) {}
+
+private:
+    const Obfuscator& obfuscator;
+    const AST& ast;
+    ChunkRefs& refs;
+    std::vector<uint8_t>& seen;
+};
+
+// Rewrites names, numbers and strings from the merged tables, which are
+// read-only by now.
+class Obfuscator::Rewriter {
+public:
+    static constexpr NodeTypeMask kVisits = RefCollector::kVisits;
+
+    Rewriter(const Obfuscator& obfuscator, AST& ast) : obfuscator(obfuscator), ast(ast) {}
+
+    bool enter(NodeId id, NodeId) {
+        ASTNodeType type = ast[id].type;
+        Atom value = ast[id].value;
+        if (type == ASTNodeType::NUMBER) {
+            ast.setValue(id, obfuscator.numberMap[value]);
+        } else if (type == ASTNodeType::STRING) {
+            ast.setValue(id, obfuscator.literalMap[value]);
+        } else if (obfuscator.options.names == NameStyle::HEX && !obfuscator.isReserved(value)) {
+            // NameStyle::SHORT names were set by renameScopes.
+            ast.setValue(id, obfuscator.nameMap[value]);
+        }
+        return true;
+    }
+    void leave(NodeId, NodeId) {}
+
+private:
+    const Obfuscator& obfuscator;
+    AST& ast;
+};
+
+// Lists the member properties the generator will look up in the string
+// table, in emission order: a member's after those inside its object. Only
+// follows the subtrees the generator emits.
+class Obfuscator::MemberCollector {
+public:
+    static constexpr NodeTypeMask kVisits = nodeTypes(ASTNodeType::MEMBER_EXPRESSION) | kHiddenSubtrees;
+
+    MemberCollector(const Obfuscator& obfuscator, const AST& ast, std::vector<Atom>& members,
+                    std::vector<uint8_t>& seen)
+        : obfuscator(obfuscator), ast(ast), members(members), seen(seen) {}
+
+    bool enter(NodeId id, NodeId) {
+        return ast[id].type == ASTNodeType::MEMBER_EXPRESSION && !obfuscator.isPlainMember(ast, id);
+    }
+    void leave(NodeId id, NodeId) {
+        if (ast[id].type != ASTNodeType::MEMBER_EXPRESSION || obfuscator.isPlainMember(ast, id)) return;
+        noteFirst(members, seen, ast[ast[ast[id].firstChild].nextSibling].value, kSeenMember);
+    }
+
+private:
+    const Obfuscator& obfuscator;
+    const AST& ast;
+    std::vector<Atom>& members;
+    std::vector<uint8_t>& seen;
+};
+
+// Lists the string-table lookups the generator will emit, in its order:
+// each function's own, and the program scope's outside any function.
+// Member uses get their index once members have indices.
+class Obfuscator::StringUseCollector {
+public:
+    static constexpr NodeTypeMask kVisits =
+        nodeTypes(ASTNodeType::STRING, ASTNodeType::MEMBER_EXPRESSION, ASTNodeType::FUNCTION_DECLARATION) |
+        kHiddenSubtrees;
+
+    StringUseCollector(const Obfuscator& obfuscator, const AST& ast, ChunkCache& cache)
+        : obfuscator(obfuscator), ast(ast), cache(cache) {}
+
+    bool enter(NodeId id, NodeId) {
+        const ASTNode& node = ast[id];
+        switch (node.type) {
+            case ASTNodeType::STRING:
+                cache.programUses.push_back({ id, node.value });
+                return false;
+            case ASTNodeType::MEMBER_EXPRESSION:
+                // The property is never emitted itself.
+                if (obfuscator.isPlainMember(ast, id)) return false;
+                cache.programUses.push_back({ id, INVALID_ATOM });
+                return true;
+            case ASTNodeType::FUNCTION_DECLARATION:
+                functionBegins.push_back(cache.programUses.size());
+                return true;
+            default:
+                return false;
+        }
+    }
+    // Uses are stacked up in programUses; a function takes its own off the
+    // top when it ends.
+    void leave(NodeId id, NodeId) {
+        if (ast[id].type != ASTNodeType::FUNCTION_DECLARATION) return;
+        auto begin = cache.programUses.begin() + static_cast<std::ptrdiff_t>(functionBegins.back());
+        functionBegins.pop_back();
+        uint32_t first = static_cast<uint32_t>(cache.functionUses.size());
+        cache.functionUses.insert(cache.functionUses.end(), begin, cache.programUses.end());
+        cache.programUses.erase(begin, cache.programUses.end());
+        cache.functions.push_back({ id, first, static_cast<uint32_t>(cache.functionUses.size()) });
+    }
+
+private:
+    const Obfuscator& obfuscator;
+    const AST& ast;
+    ChunkCache& cache;
+    std::vector<size_t> functionBegins;
+};
+
+void Obfuscator::obfuscate(AST& ast) {
+    if (options.names == NameStyle::SHORT) renameScopes(ast);
+    NodeId root = ast.root();
+    std::vector<NodeId> starts = splitProgram(ast);
+    size_t chunkCount = starts.size() - 1;
+    std::vector<ChunkRefs> refs(chunkCount);
+
+    size_t atomCount = atoms.size();
+    forEachChunk(chunkCount, [&](size_t i) {
+        std::vector<uint8_t> seen(atomCount);
+        RefCollector collector(*this, ast, refs[i], seen);
+        PassManager<RefCollector>(collector).run(ast, root, starts[i], starts[i + 1]);
+    });
+    // Merging the chunks in program order hands out names and string
+    // indices in exactly the order a single preorder walk would, whatever
+    // the thread count.
+    std::string value;
+    for (const ChunkRefs& chunk : refs) {
+        for (Atom name : chunk.names) getObfuscatedName(name);
+        for (Atom num : chunk.numbers) obfuscateNumber(num);
+        for (Atom literal : chunk.strings) {
+            value.clear();
+            appendStringValue(value, atoms.str(literal));
+            Atom index = getStringIndex(atoms.intern(value));
+            ensureSlot(literalMap, literal);
+            literalMap[literal] = index;
+        }
+    }
+
+    // Member properties become string-table lookups only when the table
+    // exists. Registering them here, rather than while generating code,
+    // keeps code generation read-only and puts them in the emitted table.
+    // The same walk finds the strings each scope reads repeatedly.
+    bool collectMembers = !stringList.empty();
+    std::vector<ChunkCache> caches(chunkCount);
+    atomCount = atoms.size();
+    forEachChunk(chunkCount, [&](size_t i) {
+        Rewriter rewriter(*this, ast);
+        if (!collectMembers) {
+            PassManager<Rewriter>(rewriter).run(ast, root, starts[i], starts[i + 1]);
+            return;
+        }
+        std::vector<uint8_t> seen(atomCount);
+        MemberCollector members(*this, ast, refs[i].members, seen);
+        StringUseCollector uses(*this, ast, caches[i]);
+        PassManager<Rewriter, MemberCollector, StringUseCollector>(rewriter, members, uses)
+            .run(ast, root, starts[i], starts[i + 1]);
+    });
+    for (const ChunkRefs& chunk : refs) {
+        for (Atom member : chunk.members) getStringIndex(member);
+    }
+    planStringCache(ast, caches);
 }
 
-std::string Obfuscator::generateCode(std::shared_ptr<ASTNode> node, int indent) {
-    if (!node) return "";
+// Declares the function and variable names a scope's statements hoist,
+// without entering nested functions. Expressions declare nothing.
+class Obfuscator::HoistedNames {
+public:
+    static constexpr NodeTypeMask kVisits = kAllNodeTypes;
 
-    std::stringstream ss;
-    std::string indentStr(indent * 2, ' ');
-    static std::string stringFunc;
+    HoistedNames(const Obfuscator& obfuscator, const AST& ast, ScopeWalk& walk)
+        : obfuscator(obfuscator), ast(ast), walk(walk) {}
 
-    switch (node->type) {
-        case ASTNodeType::PROGRAM: {
-            stringFunc.clear();
-            ss << "(async () => {\n";
-            if (!stringList.empty()) {
-                ss << "  " << generateStringTable(stringFunc) << "\n";
+    bool enter(NodeId id, NodeId) {
+        const ASTNode& node = ast[id];
+        switch (node.type) {
+            case ASTNodeType::FUNCTION_DECLARATION:
+            case ASTNodeType::VARIABLE_DECLARATION:
+                obfuscator.declareBinding(walk, node.value, scopeBegin, nextSlot);
+                return false;
+            case ASTNodeType::PROGRAM:
+            case ASTNodeType::BLOCK:
+            case ASTNodeType::IF_STATEMENT:
+            case ASTNodeType::WHILE_STATEMENT:
+            case ASTNodeType::FOR_LOOP:
+            case ASTNodeType::WHILE_LOOP:
+                return true;
+            default:
+                return false;
+        }
+    }
+    void leave(NodeId, NodeId) {}
+
+    // Set for each scope before the walk; nextSlot is advanced by it.
+    uint32_t scopeBegin = 0;
+    uint32_t nextSlot = 0;
+
+private:
+    const Obfuscator& obfuscator;
+    const AST& ast;
+    ScopeWalk& walk;
+};
+
+// Resolves every identifier to the binding it reads. Entering the program
+// or a function declares its parameters and hoisted names; leaving it
+// makes them invisible again.
+class Obfuscator::ScopeResolver {
+public:
+    static constexpr NodeTypeMask kVisits =
+        nodeTypes(ASTNodeType::PROGRAM, ASTNodeType::FUNCTION_DECLARATION, ASTNodeType::VARIABLE_DECLARATION,
+                  ASTNodeType::IDENTIFIER);
+
+    ScopeResolver(const Obfuscator& obfuscator, const AST& ast, ScopeWalk& walk)
+        : obfuscator(obfuscator), ast(ast), walk(walk), hoisted(obfuscator, ast, walk), hoistedWalk(hoisted) {}
+
+    bool enter(NodeId id, NodeId parent) {
+        const ASTNode& node = ast[id];
+        switch (node.type) {
+            case ASTNodeType::IDENTIFIER:
+                // Property names are not bindings.
+                if (parent == INVALID_NODE || ast[parent].type != ASTNodeType::MEMBER_EXPRESSION ||
+                    ast[parent].firstChild == id) {
+                    obfuscator.useBinding(walk, id, node.value);
+                }
+                return false;
+            case ASTNodeType::FUNCTION_DECLARATION:
+                // The name is bound in the enclosing scope.
+                obfuscator.useBinding(walk, id, node.value);
+                openScope(id);
+                return true;
+            case ASTNodeType::VARIABLE_DECLARATION:
+                obfuscator.useBinding(walk, id, node.value);
+                return true;
+            default:
+                openScope(id);
+                return true;
+        }
+    }
+    void leave(NodeId id, NodeId) {
+        ASTNodeType type = ast[id].type;
+        if (type != ASTNodeType::PROGRAM && type != ASTNodeType::FUNCTION_DECLARATION) return;
+        while (walk.shadowed.size() > scopes.back().shadowBegin) {
+            walk.bindingOf[walk.shadowed.back().first] = walk.shadowed.back().second;
+            walk.shadowed.pop_back();
+        }
+        scopes.pop_back();
+    }
+
+private:
+    // Bindings from bindingBegin on belong to the scope; nextSlot is the
+    // first slot free for functions nested in it.
+    struct Scope {
+        uint32_t bindingBegin;
+        size_t shadowBegin;
+        uint32_t nextSlot;
+    };
+
+    // A function's parameters resolve to their own bindings, so they are
+    // declared before its children are entered.
+    void openScope(NodeId scope) {
+        const ASTNode& node = ast[scope];
+        Scope entry{ static_cast<uint32_t>(walk.bindings.size()), walk.shadowed.size(),
+                     scopes.empty() ? 0 : scopes.back().nextSlot };
+        NodeId body = scope;
+        if (node.type == ASTNodeType::FUNCTION_DECLARATION) {
+            body = node.lastChild;
+            for (NodeId param = node.firstChild; param != body; param = ast[param].nextSibling) {
+                obfuscator.declareBinding(walk, ast[param].value, entry.bindingBegin, entry.nextSlot);
             }
-            for (const auto& child : node->children) {
-                ss << generateCode(child, 1);
+        }
+        hoisted.scopeBegin = entry.bindingBegin;
+        hoisted.nextSlot = entry.nextSlot;
+        hoistedWalk.run(ast, body);
+        entry.nextSlot = hoisted.nextSlot;
+        walk.slotCount = std::max(walk.slotCount, entry.nextSlot);
+        scopes.push_back(entry);
+    }
+
+    const Obfuscator& obfuscator;
+    const AST& ast;
+    ScopeWalk& walk;
+    HoistedNames hoisted;
+    PassManager<HoistedNames> hoistedWalk;
+    std::vector<Scope> scopes;
+};
+
+// NameStyle::SHORT: resolves every identifier to the binding it reads, the
+// way a minifier does, and renames bindings by slot. Functions are the
+// scopes: var and function declarations hoist to them, and let and const
+// are treated the same since the tree does not keep the keyword. Reads of
+// undeclared names are globals and keep their spelling; no short name may
+// spell one. Property names are not bindings and are left alone.
+void Obfuscator::renameScopes(AST& ast) {
+    NodeId root = ast.root();
+    if (root == INVALID_NODE) return;
+    ScopeWalk walk;
+    walk.bindingOf.assign(atoms.size(), kNoBinding);
+    walk.unbound.assign(atoms.size(), 0);
+    walk.declared.assign(atoms.size(), 0);
+    ScopeResolver resolver(*this, ast, walk);
+    PassManager<ScopeResolver>(resolver).run(ast, root);
+
+    // Sibling scopes add their reads to the slot they share.
+    std::vector<uint64_t> slotUses(walk.slotCount);
+    for (const Binding& binding : walk.bindings) slotUses[binding.slot] += binding.uses;
+    std::vector<uint32_t> order(walk.slotCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return slotUses[a] > slotUses[b]; });
+    std::vector<Atom> slotNames(walk.slotCount);
+    size_t next = 0;
+    for (uint32_t slot : order) {
+        for (;;) {
+            std::string name = shortName(next++);
+            if (isUnavailableName(name)) continue;
+            Atom atom = atoms.find(name);
+            if (atom != INVALID_ATOM && ((atom < walk.unbound.size() && walk.unbound[atom]) || isReserved(atom))) {
+                continue;
             }
-            ss << "})(0x1,(0xB-0x2));\n";
+            slotNames[slot] = atoms.intern(name);
             break;
         }
-        case ASTNodeType::FUNCTION_DECLARATION: {
-            ss << indentStr << "function " << node->value << "(";
-            bool first = true;
-            for (size_t i = 0; i < node->children.size() - 1; ++i) {
-                if (!first) ss << ",";
-                ss << generateCode(node->children[i], 0);
-                first = false;
+    }
+    scopedOriginals.assign(ast.size(), INVALID_ATOM);
+    for (const auto& ref : walk.refs) {
+        scopedOriginals[ref.first] = ast[ref.first].value;
+        ast.setValue(ref.first, slotNames[walk.bindings[ref.second].slot]);
+    }
+    scopedNames += walk.bindings.size();
+    scopedSources = std::move(walk.declared);
+}
+
+// Bindings from scopeBegin on belong to the scope being declared, so a
+// name declared there twice stays one binding.
+void Obfuscator::declareBinding(ScopeWalk& walk, Atom name, uint32_t scopeBegin, uint32_t& nextSlot) const {
+    if (isReserved(name)) return;
+    uint32_t previous = walk.bindingOf[name];
+    if (previous != kNoBinding && previous >= scopeBegin) return;
+    walk.shadowed.push_back({ name, previous });
+    walk.declared[name] = 1;
+    walk.bindingOf[name] = static_cast<uint32_t>(walk.bindings.size());
+    walk.bindings.push_back({ nextSlot++, 0 });
+}
+
+void Obfuscator::useBinding(ScopeWalk& walk, NodeId node, Atom name) const {
+    if (isReserved(name)) return;
+    uint32_t binding = walk.bindingOf[name];
+    if (binding == kNoBinding) {
+        walk.unbound[name] = 1;
+        return;
+    }
+    ++walk.bindings[binding].uses;
+    walk.refs.push_back({ node, binding });
+}
+
+// Settles which strings each scope decodes once into locals. Function
+// scopes never span chunks and are settled in parallel; the program scope
+// takes its uses from every chunk and is settled once they are merged.
+void Obfuscator::planStringCache(const AST& ast, std::vector<ChunkCache>& chunks) {
+    cachedScopes.clear();
+    cachedIndices.clear();
+    readsCachedString.assign(ast.size(), 0);
+    if (stringList.empty()) return;
+
+    size_t atomCount = atoms.size();
+    forEachChunk(chunks.size(), [&](size_t i) {
+        ChunkCache& chunk = chunks[i];
+        for (std::vector<StringUse>* uses : { &chunk.programUses, &chunk.functionUses }) {
+            for (StringUse& use : *uses) {
+                if (use.index != INVALID_ATOM) continue;
+                use.index = stringIndexMap[ast[ast[ast[use.node].firstChild].nextSibling].value];
             }
-            ss << ") {\n";
-            ss << generateCode(node->children.back(), indent + 1);
-            ss << indentStr << "}\n";
-            break;
         }
-        case ASTNodeType::BLOCK: {
-            for (const auto& child : node->children) {
-                ss << generateCode(child, indent);
+        std::vector<uint32_t> counts(atomCount);
+        const StringUse* uses = chunk.functionUses.data();
+        for (const ScopeUses& function : chunk.functions) {
+            cacheRepeatedStrings(function.scope, uses + function.begin, uses + function.end, chunk.scopes,
+                                 chunk.indices, counts);
+        }
+    });
+
+    std::vector<StringUse> programUses;
+    for (ChunkCache& chunk : chunks) {
+        programUses.insert(programUses.end(), chunk.programUses.begin(), chunk.programUses.end());
+        uint32_t offset = static_cast<uint32_t>(cachedIndices.size());
+        for (CachedStrings scope : chunk.scopes) {
+            scope.begin += offset;
+            scope.end += offset;
+            cachedScopes.push_back(scope);
+        }
+        cachedIndices.insert(cachedIndices.end(), chunk.indices.begin(), chunk.indices.end());
+    }
+    std::vector<uint32_t> counts(atomCount);
+    cacheRepeatedStrings(ast.root(), programUses.data(), programUses.data() + programUses.size(), cachedScopes,
+                         cachedIndices, counts);
+    std::sort(cachedScopes.begin(), cachedScopes.end(),
+              [](const CachedStrings& a, const CachedStrings& b) { return a.scope < b.scope; });
+}
+
+// counts is all zero on entry and exit.
+void Obfuscator::cacheRepeatedStrings(NodeId scope, const StringUse* begin, const StringUse* end,
+                                      std::vector<CachedStrings>& scopes, std::vector<Atom>& indices,
+                                      std::vector<uint32_t>& counts) {
+    for (const StringUse* use = begin; use != end; ++use) ++counts[use->index];
+    uint32_t first = static_cast<uint32_t>(indices.size());
+    for (const StringUse* use = begin; use != end; ++use) {
+        if (counts[use->index] >= kMinCachedUses) readsCachedString[use->node] = 1;
+    }
+    for (const StringUse* use = begin; use != end; ++use) {
+        // Zeroing on the first use lists each index once.
+        if (counts[use->index] >= kMinCachedUses) indices.push_back(use->index);
+        counts[use->index] = 0;
+    }
+    if (indices.size() > first) scopes.push_back({ scope, first, static_cast<uint32_t>(indices.size()) });
+}
+
+namespace {
+
+constexpr char kHexDigits[] = "0123456789abcdef";
+constexpr char kBase64Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+void appendHexByte(std::string& out, unsigned char c) {
+    out += "\\x";
+    out += kHexDigits[c >> 4];
+    out += kHexDigits[c & 0xF];
+}
+
+void appendHexNumber(std::string& out, uint64_t value) {
+    char digits[16];
+    size_t count = 0;
+    do {
+        digits[count++] = kHexDigits[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+    out += "0x";
+    while (count > 0) out += digits[--count];
+}
+
+void appendCodeUnit(std::string& out, uint32_t unit) {
+    out += "\\u";
+    for (int shift = 12; shift >= 0; shift -= 4) out += kHexDigits[(unit >> shift) & 0xF];
+}
+
+// Writes UTF-8 text for a single-quoted literal. With plain set, printable
+// ASCII is copied as is; other characters below U+0100 become \xNN and the
+// rest \uNNNN, one per UTF-16 code unit. Bytes that are not UTF-8 stay one
+// \xNN each.
+void appendEscaped(std::string& out, std::string_view text, bool plain) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (p < end) {
+        char c = *p;
+        uint32_t codePoint;
+        size_t length = static_cast<unsigned char>(c) < 0x80 ? 1 : decodeUtf8(p, end, codePoint);
+        if (length > 1) {
+            if (codePoint >= 0x10000) {
+                appendCodeUnit(out, 0xD800 + ((codePoint - 0x10000) >> 10));
+                appendCodeUnit(out, 0xDC00 + ((codePoint - 0x10000) & 0x3FF));
+            } else if (codePoint >= 0x100) {
+                appendCodeUnit(out, codePoint);
+            } else {
+                appendHexByte(out, static_cast<unsigned char>(codePoint));
+            }
+            p += length;
+            continue;
+        }
+        if (c == '\'') out += "\\'";
+        else if (c == '\\') out += "\\\\";
+        else if (c == '\n') out += "\\n";
+        else if (c == '\t') out += "\\t";
+        else if (plain && c >= 0x20 && c < 0x7f) out += c;
+        else appendHexByte(out, static_cast<unsigned char>(c));
+        ++p;
+    }
+}
+
+bool isAscii(std::string_view text) {
+    for (char c : text) {
+        if (static_cast<unsigned char>(c) >= 0x80) return false;
+    }
+    return true;
+}
+
+// JavaScript that turns the characters atob() gives for UTF-8 bytes back
+// into the text, surrogates included. Only the decoding encodings need it,
+// and only for tables with text past ASCII.
+constexpr std::string_view kUtf8Decoder =
+    "function(_0x2){for(var _0x3='',_0x4=0,_0x9,_0xa;_0x4<_0x2.length;_0x4++){_0x9=_0x2.charCodeAt(_0x4);"
+    "if(_0x9>0x7f){_0xa=_0x9>0xef?3:_0x9>0xdf?2:1;_0x9&=0x7f>>_0xa+1;"
+    "while(_0xa--)_0x9=_0x9<<6|_0x2.charCodeAt(++_0x4)&0x3f;}_0x3+=String.fromCodePoint(_0x9);}return _0x3;}";
+
+// atob() turns this back into one character per byte, which kUtf8Decoder
+// then reads as UTF-8 when the table needs it.
+void appendBase64(std::string& out, std::string_view bytes) {
+    size_t i = 0;
+    for (; i + 3 <= bytes.size(); i += 3) {
+        uint32_t v = static_cast<uint8_t>(bytes[i]) << 16 | static_cast<uint8_t>(bytes[i + 1]) << 8 |
+                     static_cast<uint8_t>(bytes[i + 2]);
+        out += kBase64Digits[v >> 18];
+        out += kBase64Digits[(v >> 12) & 63];
+        out += kBase64Digits[(v >> 6) & 63];
+        out += kBase64Digits[v & 63];
+    }
+    size_t rest = bytes.size() - i;
+    if (rest == 0) return;
+    uint32_t v = static_cast<uint8_t>(bytes[i]) << 16;
+    if (rest == 2) v |= static_cast<uint8_t>(bytes[i + 1]) << 8;
+    out += kBase64Digits[v >> 18];
+    out += kBase64Digits[(v >> 12) & 63];
+    out += rest == 2 ? kBase64Digits[(v >> 6) & 63] : '=';
+    out += '=';
+}
+
+// Generated names are hex digits after "_0x", so the 's' keeps these
+// locals apart from them.
+void appendCachedName(std::string& out, std::string_view index) {
+    out += "_0xs";
+    out += index.substr(2);
+}
+
+} // namespace
+
+// The table holds stringList in index order, except that SHUFFLE stores
+// string i at (i * stride + offset) % count. The key and the permutation are
+// derived from the strings themselves, so output stays deterministic.
+void Obfuscator::generateStringTable(std::string& out, std::string& funcName) {
+    std::string tableName = generateNewName();
+    funcName = generateNewName();
+    const size_t count = stringList.size();
+    uint64_t seed = 0;
+    if (options.strings == StringEncoding::SHUFFLE || options.strings == StringEncoding::XOR) {
+        for (Atom text : stringList) seed = xxhash64(atoms.str(text), seed);
+    }
+
+    std::vector<Atom> order(stringList);
+    if (options.strings == StringEncoding::SHUFFLE && count > 1) {
+        // Strides 1 and count - 1 only rotate or reverse the table, so they
+        // are left for the counts with no other stride coprime to them: 2, 3,
+        // 4 and 6. Reversing is never the identity, and stride 1 only comes
+        // with 2 strings, which it swaps.
+        shuffleStride = 0;
+        if (count > 4) {
+            size_t candidates = count - 3;
+            for (size_t k = 0; k < candidates && shuffleStride == 0; ++k) {
+                size_t stride = 2 + (seed + k) % candidates;
+                if (std::gcd(stride, count) == 1) shuffleStride = stride;
             }
-            break;
         }
-        case ASTNodeType::RETURN_STATEMENT: {
-            ss << indentStr << "return ";
-            if (!node->children.empty()) {
-                ss << generateCode(node->children[0], 0);
+        if (shuffleStride == 0) shuffleStride = count - 1;
+        shuffleOffset = shuffleStride == 1 ? 1 : (seed >> 32) % count;
+        for (size_t i = 0; i < count; ++i) order[(i * shuffleStride + shuffleOffset) % count] = stringList[i];
+    } else {
+        shuffleStride = 1;
+        shuffleOffset = 0;
+    }
+    for (size_t k = 0; k < xorKey.size(); ++k) {
+        uint8_t byte = static_cast<uint8_t>(seed >> (8 * k));
+        xorKey[k] = byte != 0 ? byte : 0xa5;
+    }
+
+    out += "var ";
+    out += tableName;
+    out += "=['";
+    std::string scratch;
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) out += "','";
+        std::string_view text = atoms.str(order[i]);
+        switch (options.strings) {
+            case StringEncoding::HEX:
+            case StringEncoding::SHUFFLE:
+                appendEscaped(out, text, options.strings == StringEncoding::SHUFFLE);
+                break;
+            case StringEncoding::BASE64:
+                appendBase64(out, text);
+                break;
+            case StringEncoding::XOR:
+                // The key rotates with the string's index as well as the
+                // byte position, so equal prefixes encode differently.
+                scratch.assign(text);
+                for (size_t j = 0; j < scratch.size(); ++j) scratch[j] ^= xorKey[(i + j) % xorKey.size()];
+                appendBase64(out, scratch);
+                break;
+        }
+    }
+    out += "'];";
+    appendStringDecoder(out, tableName, funcName);
+}
+
+void Obfuscator::appendStringDecoder(std::string& out, const std::string& tableName, const std::string& funcName) {
+    bool utf8 = false;
+    for (Atom text : stringList) utf8 = utf8 || !isAscii(atoms.str(text));
+    out += "var ";
+    out += funcName;
+    switch (options.strings) {
+        case StringEncoding::HEX:
+            out += "=function(_0x1){return ";
+            out += tableName;
+            out += "[_0x1];};";
+            break;
+        case StringEncoding::SHUFFLE:
+            out += "=function(_0x1){return ";
+            out += tableName;
+            out += "[(_0x1*";
+            appendHexNumber(out, shuffleStride);
+            out += '+';
+            appendHexNumber(out, shuffleOffset);
+            out += ")%";
+            appendHexNumber(out, stringList.size());
+            out += "];};";
+            break;
+        // The decoding encodings remember each string in _0x6 the first
+        // time it is asked for, so repeated reads cost one array lookup.
+        case StringEncoding::BASE64:
+            out += utf8 ? "=(function(_0x6,_0x8){" : "=(function(_0x6){";
+            out += "return function(_0x1){var _0x7=_0x6[_0x1];return _0x7!==undefined?_0x7:(_0x6[_0x1]=";
+            out += utf8 ? "_0x8(atob(" : "atob(";
+            out += tableName;
+            out += utf8 ? "[_0x1])));};})([]" : "[_0x1]));};})([]";
+            if (utf8) {
+                out += ',';
+                out += kUtf8Decoder;
             }
-            ss << ";\n";
+            out += ");";
             break;
-        }
-        case ASTNodeType::FUNCTION_CALL: {
-            ss << indentStr;
-            if (node->children[0]->type == ASTNodeType::MEMBER_EXPRESSION) {
-                auto member = node->children[0];
-                std::string objName = member->children[0]->value;
-                std::string propName = member->children[1]->value;
-                if (reservedNames.count(objName) && reservedNames.count(propName)) {
-                    ss << objName << "." << propName;
-                } else if (!stringFunc.empty()) {
-                    ss << generateCode(member->children[0], 0) << "[" << stringFunc << "(";
-                    ss << getStringIndex(member->children[1]->value) << ")]";
-                } else {
-                    ss << generateCode(member->children[0], 0) << "." << generateCode(member->children[1], 0);
-                }
-            } else {
-                ss << generateCode(node->children[0], 0);
-            }
-            ss << "(";
-            for (size_t i = 1; i < node->children.size(); ++i) {
-                if (i > 1) ss << ",";
-                if (node->children[i]->type == ASTNodeType::FUNCTION_CALL) {
-                    std::string argCode = generateCode(node->children[i], 0);
-                    if (argCode.size() >= 2 && argCode.substr(argCode.size() - 2) == ";\n") {
-                        argCode = argCode.substr(0, argCode.size() - 2);
-                    }
-                    ss << argCode;
-                } else {
-                    ss << generateCode(node->children[i], 0);
-                }
+        case StringEncoding::XOR:
+            out += utf8 ? "=(function(_0x5,_0x6,_0x8){" : "=(function(_0x5,_0x6){";
+            out += "return function(_0x1){var _0x7=_0x6[_0x1];"
+                   "if(_0x7!==undefined)return _0x7;var _0x2=atob(";
+            out += tableName;
+            out += "[_0x1]),_0x3='';for(var _0x4=0;_0x4<_0x2.length;_0x4++)"
+                   "_0x3+=String.fromCharCode(_0x2.charCodeAt(_0x4)^_0x5[(_0x1+_0x4)%";
+            out += std::to_string(xorKey.size());
+            out += utf8 ? "]);return _0x6[_0x1]=_0x8(_0x3);};})([" : "]);return _0x6[_0x1]=_0x3;};})([";
+            for (size_t k = 0; k < xorKey.size(); ++k) {
+                if (k > 0) out += ',';
+                appendHexNumber(out, xorKey[k]);
             }
-            ss << ")";
-            if (indent > 0) {
-                ss << ";\n";
+            out += "],[]";
+            if (utf8) {
+                out += ',';
+                out += kUtf8Decoder;
             }
+            out += ");";
             break;
+    }
+}
+
+void Obfuscator::generateStringLookup(Atom index, bool cached, std::string& out) const {
+    if (cached) {
+        appendCachedName(out, atoms.str(index));
+        return;
+    }
+    out += stringFunc;
+    out += '(';
+    out += atoms.str(index);
+    out += ')';
+}
+
+template <class Layout>
+void Obfuscator::generateCachedStrings(NodeId scope, int indent, std::string& out) const {
+    auto it = std::lower_bound(cachedScopes.begin(), cachedScopes.end(), scope,
+                               [](const CachedStrings& a, NodeId b) { return a.scope < b; });
+    if (it == cachedScopes.end() || it->scope != scope) return;
+    Layout::indent(out, indent);
+    out += "var ";
+    for (uint32_t i = it->begin; i < it->end; ++i) {
+        if (i > it->begin) out += ',';
+        appendCachedName(out, atoms.str(cachedIndices[i]));
+        out += '=';
+        generateStringLookup(cachedIndices[i], false, out);
+    }
+    out += ';';
+    Layout::newline(out);
+}
+
+bool Obfuscator::readsCached(NodeId id) const {
+    return id < readsCachedString.size() && readsCachedString[id];
+}
+
+// Adds a source-map segment for the code about to be appended to out,
+// naming the identifier a named node was renamed from.
+void Obfuscator::mapNode(const AST& ast, NodeId id, bool named, std::string& out, MappingEncoder* map) const {
+    if (!map) return;
+    uint32_t name = kNoSourceName;
+    if (named) {
+        Atom key = options.names == NameStyle::HEX ? ast[id].value
+                   : id < scopedOriginals.size() ? scopedOriginals[id] : INVALID_ATOM;
+        if (key < sourceNameIndex.size()) name = sourceNameIndex[key];
+    }
+    map->add(out, ast.sourceOffset(id), name);
+}
+
+// Lists, in atom order, every identifier the run renamed, for the map's
+// names. Hex names are one per original, so they are looked up by the new
+// atom; short names are shared and go by the original kept per node.
+void Obfuscator::collectSourceNames(SourceMap& map) {
+    map.names.clear();
+    sourceNameIndex.assign(atoms.size(), kNoSourceName);
+    for (Atom atom = 0; atom < atoms.size(); ++atom) {
+        if (options.names == NameStyle::HEX) {
+            if (atom >= nameMap.size() || nameMap[atom] == INVALID_ATOM) continue;
+            sourceNameIndex[nameMap[atom]] = static_cast<uint32_t>(map.names.size());
+        } else {
+            if (atom >= scopedSources.size() || !scopedSources[atom]) continue;
+            sourceNameIndex[atom] = static_cast<uint32_t>(map.names.size());
         }
-        case ASTNodeType::MEMBER_EXPRESSION: {
-            std::string objName = node->children[0]->value;
-            std::string propName = node->children[1]->value;
-            if (reservedNames.count(objName) && reservedNames.count(propName)) {
-                ss << objName << "." << propName;
-            } else if (!stringFunc.empty()) {
-                ss << generateCode(node->children[0], 0) << "[" << stringFunc << "(";
-                ss << getStringIndex(node->children[1]->value) << ")]";
+        map.names.emplace_back(atoms.str(atom));
+    }
+}
+
+// Appends the code for the statements it walks to out. Text between
+// operands is written as the next operand is entered, and parentheses
+// around an operand unless it binds at least as tightly as its place
+// needs. Statements are prefixed with indent levels of two spaces;
+// expressions are always generated with indent 0.
+template <class Layout>
+class Obfuscator::Generator {
+public:
+    static constexpr NodeTypeMask kVisits = kAllNodeTypes;
+
+    Generator(const Obfuscator& obfuscator, const AST& ast, std::string& out, MappingEncoder* map)
+        : obfuscator(obfuscator), atoms(obfuscator.atoms), ast(ast), out(out), map(map) {}
+
+    bool enter(NodeId id, NodeId parent);
+    void leave(NodeId id, NodeId parent);
+
+private:
+    // What a node was entered with, for its children and for leaving it.
+    struct Frame {
+        int indent;
+        bool emitted;
+        bool grouped;
+        bool statement;
+        bool callee;
+    };
+
+    bool enterOperand(NodeId id, NodeId parent, Frame& frame, uint8_t& precedence);
+    void openBody(NodeId function, int indent);
+
+    const Obfuscator& obfuscator;
+    const AtomTable& atoms;
+    const AST& ast;
+    std::string& out;
+    MappingEncoder* map;
+    std::vector<Frame> frames;
+    Frame leaf{};
+    bool atLeaf = false;
+};
+
+template <class Layout>
+bool Obfuscator::Generator<Layout>::enter(NodeId id, NodeId parent) {
+    const ASTNode& node = ast[id];
+    // Walks start at top-level statements, inside the program wrapper.
+    Frame frame{ 1, true, false, false, false };
+    uint8_t precedence = PREC_NONE;
+    if (!frames.empty()) {
+        frame.indent = 0;
+        frame.emitted = enterOperand(id, parent, frame, precedence);
+        if (!frame.emitted) {
+            leaf = frame;
+            atLeaf = true;
+            return false;
+        }
+    }
+    frame.grouped = precedenceOf(node) < precedence;
+    if (frame.grouped) out += '(';
+    if (frame.indent > 0 && isPlainExpression(node.type)) {
+        Layout::indent(out, frame.indent);
+        frame.indent = 0;
+        frame.statement = true;
+    }
+
+    bool descend = true;
+    switch (node.type) {
+        case ASTNodeType::FUNCTION_DECLARATION:
+            Layout::indent(out, frame.indent);
+            out += "function ";
+            obfuscator.mapNode(ast, id, true, out, map);
+            out += atoms.str(node.value);
+            out += '(';
+            if (node.firstChild == INVALID_NODE) openBody(id, frame.indent);
+            break;
+        case ASTNodeType::BLOCK:
+            break;
+        case ASTNodeType::RETURN_STATEMENT:
+            Layout::indent(out, frame.indent);
+            obfuscator.mapNode(ast, id, false, out, map);
+            out += "return";
+            if (node.childCount > 0) {
+                out += ' ';
             } else {
-                ss << generateCode(node->children[0], 0) << "." << generateCode(node->children[1], 0);
+                Layout::space(out);
+            }
+            break;
+        case ASTNodeType::FUNCTION_CALL:
+            Layout::indent(out, frame.indent);
+            break;
+        case ASTNodeType::MEMBER_EXPRESSION:
+            if (obfuscator.isPlainMember(ast, id)) {
+                NodeId object = node.firstChild;
+                obfuscator.mapNode(ast, id, false, out, map);
+                out += atoms.str(ast[object].value);
+                out += '.';
+                out += atoms.str(ast[ast[object].nextSibling].value);
+                descend = false;
             }
             break;
-        }
         case ASTNodeType::EXPRESSION:
-        case ASTNodeType::BINARY_EXPRESSION: {
-            ss << "(" << generateCode(node->children[0], 0) << " " << node->value << " " 
-               << generateCode(node->children[1], 0) << ")";
+        case ASTNodeType::BINARY_EXPRESSION:
+        case ASTNodeType::POSTFIX_EXPRESSION:
+        case ASTNodeType::CONDITIONAL_EXPRESSION:
+            break;
+        case ASTNodeType::UNARY_EXPRESSION: {
+            std::string_view op = atoms.str(node.value);
+            out += op;
+            // "-" and "-a" must not fuse into "--a".
+            const ASTNode& operand = ast[node.firstChild];
+            if (operand.type == ASTNodeType::UNARY_EXPRESSION && atoms.str(operand.value).front() == op.back()) {
+                out += ' ';
+            }
             break;
         }
         case ASTNodeType::IDENTIFIER:
-        case ASTNodeType::NUMBER: {
-            ss << node->value;
+        case ASTNodeType::NUMBER:
+            obfuscator.mapNode(ast, id, node.type == ASTNodeType::IDENTIFIER, out, map);
+            out += atoms.str(node.value);
+            descend = false;
             break;
-        }
-        case ASTNodeType::STRING: {
-            if (!stringFunc.empty()) {
-                ss << stringFunc << "(" << node->value << ")";
+        case ASTNodeType::STRING:
+            obfuscator.mapNode(ast, id, false, out, map);
+            if (!obfuscator.stringFunc.empty()) {
+                obfuscator.generateStringLookup(node.value, obfuscator.readsCached(id), out);
             } else {
-                ss << "'" << stringList[std::stoi(node->value.substr(2))] << "'";
+                // The list holds decoded text; escape it as the string table does.
+                size_t index = std::stoul(std::string(atoms.str(node.value).substr(2)), nullptr, 16);
+                out += '\'';
+                appendEscaped(out, atoms.str(obfuscator.stringList[index]), true);
+                out += '\'';
             }
+            descend = false;
             break;
+        default:
+            descend = false;
+            break;
+    }
+    // Nodes without a walked subtree are left straight after, so they keep
+    // their frame out of the stack.
+    if (descend) {
+        frames.push_back(frame);
+    } else {
+        leaf = frame;
+        atLeaf = true;
+    }
+    return descend;
+}
+
+// Writes what comes before a child of parent and decides how the child is
+// generated. Returns false for children that are not generated at all.
+template <class Layout>
+bool Obfuscator::Generator<Layout>::enterOperand(NodeId id, NodeId parent, Frame& frame, uint8_t& precedence) {
+    const ASTNode& owner = ast[parent];
+    const Frame& outer = frames.back();
+    switch (owner.type) {
+        case ASTNodeType::FUNCTION_DECLARATION:
+            if (id == owner.lastChild) {
+                openBody(parent, outer.indent);
+                frame.indent = outer.indent + 1;
+            } else if (id != owner.firstChild) {
+                out += ',';
+            }
+            return true;
+        case ASTNodeType::BLOCK:
+            frame.indent = outer.indent;
+            return true;
+        case ASTNodeType::RETURN_STATEMENT:
+            return id == owner.firstChild;
+        case ASTNodeType::FUNCTION_CALL:
+            if (id == owner.firstChild) {
+                precedence = PREC_PRIMARY;
+                frame.callee = true;
+                return true;
+            }
+            // A sequence argument keeps its parentheses.
+            if (id != ast[owner.firstChild].nextSibling) out += ',';
+            precedence = PREC_ASSIGN;
+            return true;
+        case ASTNodeType::MEMBER_EXPRESSION: {
+            if (id == owner.firstChild) {
+                precedence = PREC_PRIMARY;
+                return true;
+            }
+            if (obfuscator.stringFunc.empty()) {
+                out += '.';
+                return true;
+            }
+            obfuscator.mapNode(ast, id, false, out, map);
+            out += '[';
+            obfuscator.generateStringLookup(obfuscator.stringIndexMap[ast[id].value], obfuscator.readsCached(parent),
+                                            out);
+            out += ']';
+            return false;
+        }
+        case ASTNodeType::EXPRESSION:
+        case ASTNodeType::BINARY_EXPRESSION: {
+            // Assignments group to the right, everything else to the left;
+            // an operand on the grouping side may share the precedence.
+            uint8_t binding = binaryPrecedence(owner.value);
+            bool rightAssoc = binding == PREC_ASSIGN;
+            if (id == owner.firstChild) {
+                precedence = binding + (rightAssoc ? 1 : 0);
+                return true;
+            }
+            if (id != ast[owner.firstChild].nextSibling) return false;
+            std::string_view op = atoms.str(owner.value);
+            if (owner.value != ATOM_COMMA) Layout::space(out);
+            out += op;
+            // Even compact code keeps a + +b and a < !b apart: "++" is
+            // another operator and "<!--" opens a comment.
+            char next = leadingOperator(ast, id);
+            if (next != 0 && ((next == op.back() && (next == '+' || next == '-')) || (op.back() == '<' && next == '!'))) {
+                out += ' ';
+            } else {
+                Layout::space(out);
+            }
+            precedence = binding + (rightAssoc ? 0 : 1);
+            return true;
+        }
+        case ASTNodeType::UNARY_EXPRESSION:
+            precedence = PREC_PREFIX;
+            return id == owner.firstChild;
+        case ASTNodeType::POSTFIX_EXPRESSION:
+            precedence = PREC_POSTFIX;
+            return id == owner.firstChild;
+        case ASTNodeType::CONDITIONAL_EXPRESSION: {
+            if (id == owner.firstChild) {
+                precedence = PREC_CONDITIONAL + 1;
+                return true;
+            }
+            NodeId consequent = ast[owner.firstChild].nextSibling;
+            if (id != consequent && id != ast[consequent].nextSibling) return false;
+            Layout::space(out);
+            out += id == consequent ? '?' : ':';
+            Layout::space(out);
+            precedence = PREC_ASSIGN;
+            return true;
         }
+        default:
+            return false;
+    }
+}
+
+template <class Layout>
+void Obfuscator::Generator<Layout>::openBody(NodeId function, int indent) {
+    out += ')';
+    Layout::space(out);
+    out += '{';
+    Layout::newline(out);
+    obfuscator.generateCachedStrings<Layout>(function, indent + 1, out);
+}
+
+template <class Layout>
+void Obfuscator::Generator<Layout>::leave(NodeId id, NodeId) {
+    Frame frame = leaf;
+    if (atLeaf) {
+        atLeaf = false;
+    } else {
+        frame = frames.back();
+        frames.pop_back();
+    }
+    if (!frame.emitted) return;
+    const ASTNode& node = ast[id];
+    switch (node.type) {
+        case ASTNodeType::FUNCTION_DECLARATION:
+            Layout::closeBlock(out);
+            Layout::indent(out, frame.indent);
+            out += '}';
+            Layout::newline(out);
+            break;
+        case ASTNodeType::RETURN_STATEMENT:
+            out += ';';
+            Layout::newline(out);
+            break;
+        case ASTNodeType::FUNCTION_CALL:
+            out += ')';
+            if (frame.indent > 0) {
+                out += ';';
+                Layout::newline(out);
+            }
+            break;
+        case ASTNodeType::POSTFIX_EXPRESSION:
+            out += atoms.str(node.value);
+            break;
         default:
             break;
     }
-    return ss.str();
+    if (frame.grouped) out += ')';
+    if (frame.statement) {
+        out += ';';
+        Layout::newline(out);
+    }
+    // Arguments follow the callee, parenthesized or not.
+    if (frame.callee) out += '(';
+}
+
+std::string Obfuscator::generateObfuscatedCode(const AST& ast) {
+    std::string out;
+    generateObfuscatedCode(ast, out);
+    return out;
+}
+
+// With a source map, each chunk encodes its own mappings next to its code,
+// and they are spliced together in the same order as the code.
+void Obfuscator::generateObfuscatedCode(const AST& ast, std::string& out, SourceMap* sourceMap) {
+    out.clear();
+    MappingEncoder* map = nullptr;
+    if (sourceMap) {
+        collectSourceNames(*sourceMap);
+        sourceMap->mappings.reset(&sourceMap->lines);
+        map = &sourceMap->mappings;
+    }
+    if (ast.root() == INVALID_NODE) return;
+    if (options.compact) {
+        generateProgram<CompactLayout>(ast, out, sourceMap);
+    } else {
+        generateProgram<PrettyLayout>(ast, out, sourceMap);
+    }
+    if (sourceMap) {
+        map->finish(out);
+        if (!sourceMap->url.empty()) {
+            out += "//# sourceMappingURL=";
+            out += sourceMap->url;
+            out += '\n';
+        }
+    }
 }
 
-std::string Obfuscator::generateObfuscatedCode(std::shared_ptr<ASTNode> ast) {
-    return generateCode(ast, 0);
-}
\ No newline at end of file
+// The program wrapper and string table are written here; the top-level
+// statements are generated chunk by chunk, each into its own buffer when
+// there is more than one, and joined in order.
+template <class Layout>
+void Obfuscator::generateProgram(const AST& ast, std::string& out, SourceMap* sourceMap) {
+    MappingEncoder* map = sourceMap ? &sourceMap->mappings : nullptr;
+    std::vector<NodeId> starts = splitProgram(ast);
+    size_t chunkCount = starts.size() - 1;
+    // Obfuscated output is usually a little larger than the node count
+    // times the average rewritten token; start there to avoid most regrowth.
+    size_t estimate = ast.size() * 12;
+
+    stringFunc.clear();
+    out += "(async";
+    Layout::space(out);
+    out += "()";
+    Layout::space(out);
+    out += "=>";
+    Layout::space(out);
+    out += '{';
+    Layout::newline(out);
+    if (!stringList.empty()) {
+        Layout::indent(out, 1);
+        generateStringTable(out, stringFunc);
+        Layout::newline(out);
+        generateCachedStrings<Layout>(ast.root(), 1, out);
+    }
+    if (chunkCount <= 1) {
+        out.reserve(out.size() + estimate);
+        if (chunkCount == 1) {
+            Generator<Layout> generator(*this, ast, out, map);
+            PassManager<Generator<Layout>>(generator).run(ast, ast.root(), starts[0], INVALID_NODE);
+        }
+    } else {
+        std::vector<std::string> parts(chunkCount);
+        std::vector<MappingEncoder> partMaps(map ? chunkCount : 0);
+        forEachChunk(chunkCount, [&](size_t i) {
+            parts[i].reserve(estimate / chunkCount);
+            MappingEncoder* partMap = nullptr;
+            if (map) {
+                partMap = &partMaps[i];
+                partMap->reset(&sourceMap->lines);
+            }
+            Generator<Layout> generator(*this, ast, parts[i], partMap);
+            PassManager<Generator<Layout>>(generator).run(ast, ast.root(), starts[i], starts[i + 1]);
+            if (partMap) partMap->finish(parts[i]);
+        });
+        size_t total = out.size();
+        for (const std::string& part : parts) total += part.size();
+        out.reserve(total + 32);
+        for (size_t i = 0; i < chunkCount; ++i) {
+            size_t start = out.size();
+            out += parts[i];
+            if (map) map->append(out, partMaps[i], start);
+        }
+    }
+    Layout::closeBlock(out);
+    out += "})(0x1,(0xB-0x2));\n";
+}
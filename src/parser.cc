@@ -6,24 +6,88 @@
  */
 #include "parser.h"
 #include <iostream>
+#include <memory>
+#include <utility>
+
+namespace {
+
+// Kinds of Parser::PendingOp. Groups have PREC_NONE so operators never
+// reduce across them.
+enum PendingKind : uint8_t {
+    PENDING_BINARY,
+    PENDING_PREFIX,
+    PENDING_ELSE,
+    PENDING_PAREN,
+    PENDING_CALL,
+    PENDING_THEN
+};
+
+// Statements a block is the body of; see Parser::OpenBody.
+enum OpenKind : uint8_t {
+    OPEN_BLOCK,
+    OPEN_FUNCTION,
+    OPEN_THEN,
+    OPEN_ELSE,
+    OPEN_WHILE
+};
+
+// Returned in place of a statement that continues in an opened block.
+constexpr NodeId kOpenedBody = INVALID_NODE - 1;
+
+} // namespace
+
+Parser::Parser(TokenSource& tokens, AST& tree) : Parser(tokens, nullptr, tree) {}
+
+Parser::Parser(TokenStream tokens, AST& tree)
+    : Parser(std::make_unique<TokenStreamSource>(std::move(tokens)), tree) {}
+
+Parser::Parser(std::unique_ptr<TokenSource> owned, AST& tree) : Parser(*owned, std::move(owned), tree) {}
+
+Parser::Parser(TokenSource& tokens, std::unique_ptr<TokenSource>&& owned, AST& tree)
+    : ownedSource(std::move(owned)), source(tokens), text(tokens.text()), ringTypes(kRingSize),
+      ringAtoms(kRingSize), ringOffsets(kRingSize), ringLengths(kRingSize), ast(tree) {
+    ast.reserve(ast.size() + source.sizeHint() / 2);
+    refill();
+}
 
-Parser::Parser(const std::vector<Token>& toks) : tokens(toks), currentIndex(0) {}
-
-bool Parser::isAtEnd() const {
-    return currentIndex >= tokens.size();
+void Parser::refill() {
+    // The ring is empty here, so everything up to the wrap point is free.
+    size_t start = tail & kRingMask;
+    size_t room = kRingSize - start;
+    TokenSlots slots = { &ringTypes[start], &ringAtoms[start], &ringOffsets[start], &ringLengths[start] };
+    size_t filled = source.fill(slots, room);
+    if (filled == 0) {
+        // Not counted in tail, so every later advance() stays on it.
+        ringTypes[start] = TokenType::END;
+        ringAtoms[start] = ATOM_EMPTY;
+        ringOffsets[start] = static_cast<uint32_t>(text.size());
+        ringLengths[start] = 0;
+    }
+    tail += filled;
 }
 
-const Token& Parser::peek() const {
-    if (isAtEnd()) throw std::runtime_error("End of tokens");
-    return tokens[currentIndex];
+Token Parser::peek() const {
+    size_t slot = head & kRingMask;
+    return { ringTypes[slot], ringAtoms[slot], text.substr(ringOffsets[slot], ringLengths[slot]) };
 }
 
 void Parser::advance() {
-    if (!isAtEnd()) currentIndex++;
+    if (isAtEnd()) return;
+    if (++head == tail) refill();
+}
+
+std::ostream& Parser::error() {
+    OBF_STAT(++stats.errors;)
+    return std::cerr;
+}
+
+void Parser::skipToken() {
+    OBF_STAT(if (!isAtEnd()) ++stats.skippedTokens;)
+    advance();
 }
 
-bool Parser::matchToken(const std::string& val) {
-    if (!isAtEnd() && tokens[currentIndex].value == val) {
+bool Parser::matchToken(Atom val) {
+    if (currentAtom() == val) {
         advance();
         return true;
     }
@@ -31,490 +95,554 @@ bool Parser::matchToken(const std::string& val) {
 }
 
 bool Parser::matchTokenType(TokenType type) {
-    if (!isAtEnd() && tokens[currentIndex].type == type) {
+    if (currentType() == type) {
         advance();
         return true;
     }
     return false;
 }
 
-std::shared_ptr<ASTNode> Parser::parseProgram() {
-    auto programNode = std::make_shared<ASTNode>(ASTNodeType::PROGRAM, "program");
+NodeId Parser::parseProgram() {
+    auto programNode = ast.addNode(ASTNodeType::PROGRAM, ATOM_PROGRAM, 0);
+    ast.setRoot(programNode);
 
     while (!isAtEnd()) {
         auto stmt = parseStatement();
-        if (stmt) {
-            programNode->children.push_back(stmt);
+        if (stmt != INVALID_NODE) {
+            ast.appendChild(programNode, stmt);
         } else {
-            std::cerr << "err: UNknown node, i'll continue...\n";
-            advance();
+            error() << "err: UNknown node, i'll continue...\n";
+            skipToken();
         }
     }
 
     return programNode;
 }
 
-std::shared_ptr<ASTNode> Parser::parseStatement() {
-    if (isAtEnd()) return nullptr;
+NodeId Parser::parseStatement() {
+    size_t base = bodies.size();
+    return completeStatement(base, beginStatement());
+}
 
-    const Token& token = peek();
+NodeId Parser::parseBlock() {
+    size_t base = bodies.size();
+    return completeStatement(base, openBody(INVALID_NODE, OPEN_BLOCK));
+}
 
-    if (token.type == TokenType::KEYWORD) {
-        if (token.value == "if") return parseIfStatement();
-        if (token.value == "while") return parseWhileStatement();
-        if (token.value == "var" || token.value == "let" || token.value == "const") return parseVariableDeclaration();
-        if (token.value == "return") return parseReturnStatement();
-        if (token.value == "function") return parseFunctionDeclaration();
-    }
+NodeId Parser::beginStatement() {
+    if (isAtEnd()) return INVALID_NODE;
 
-    if (token.type == TokenType::IDENTIFIER) {
-        auto expr = parseExpression();
-        if (!isAtEnd() && peek().value == ";") {
-            advance();
-        }
-        return expr;
-    }
-
-    if (token.value == "{") {
-        return parseBlock();
+    switch (currentAtom()) {
+        case ATOM_IF: return parseIfStatement();
+        case ATOM_WHILE: return parseWhileStatement();
+        case ATOM_VAR:
+        case ATOM_LET:
+        case ATOM_CONST: return parseVariableDeclaration();
+        case ATOM_RETURN: return parseReturnStatement();
+        case ATOM_FUNCTION: return parseFunctionDeclaration();
+        case ATOM_LBRACE: return openBody(INVALID_NODE, OPEN_BLOCK);
+        default: break;
     }
 
     auto expr = parseExpression();
-    if (!isAtEnd() && peek().value == ";") {
-        advance();
-    }
+    matchToken(ATOM_SEMICOLON);
     return expr;
 }
 
-std::shared_ptr<ASTNode> Parser::parseFunctionDeclaration() {
-    advance();
-    if (isAtEnd() || peek().type != TokenType::IDENTIFIER) {
-        std::cerr << "err: waiting function nanme\n";
-        return nullptr;
-    }
-    std::string funcName = peek().value;
-    advance();
-    if (!matchToken("(")) {
-        std::cerr << "err: waiting '('for function parameter\n";
-        return nullptr;
-    }
-    auto funcNode = std::make_shared<ASTNode>(ASTNodeType::FUNCTION_DECLARATION, funcName);
-    while (!isAtEnd() && peek().value != ")") {
-        if (peek().type != TokenType::IDENTIFIER) {
-            std::cerr << "err: waiting parameter name\n";
-            return nullptr;
+// Blocks nest through the bodies stack rather than through C++ calls, so
+// nesting depth costs heap, not stack. Parses the statements of every block
+// opened above base, finishing the statements they are bodies of, and
+// returns the statement begun at base.
+NodeId Parser::completeStatement(size_t base, NodeId statement) {
+    while (bodies.size() > base) {
+        if (statement != kOpenedBody) {
+            if (statement != INVALID_NODE) {
+                ast.appendChild(bodies.back().block, statement);
+            } else {
+                skipToken();
+            }
         }
-        auto param = std::make_shared<ASTNode>(ASTNodeType::IDENTIFIER, peek().value);
-        funcNode->children.push_back(param);
-        advance();
-
-        if (peek().value == ",") {
-            advance();
+        if (!isAtEnd() && currentAtom() != ATOM_RBRACE) {
+            statement = beginStatement();
+            continue;
         }
+        if (!matchToken(ATOM_RBRACE)) {
+            error() << "err: waiting '}' \n";
+        }
+        OpenBody body = bodies.back();
+        bodies.pop_back();
+        statement = finishBody(body);
     }
-    if (!matchToken(")")) {
-        std::cerr << "err: waiting ')'\n";
-        return nullptr;
-    }
+    return statement;
+}
 
-    auto body = parseBlock();
-    if (!body) {
-        std::cerr << "err: waiting function torsio\n";
-        return nullptr;
+// Opens the block that is owner's body, or finishes owner without one.
+NodeId Parser::openBody(NodeId owner, uint8_t kind) {
+    uint32_t offset = currentOffset();
+    if (!matchToken(ATOM_LBRACE)) {
+        error() << "err: waiting '{' \n";
+        return finishBody({ owner, INVALID_NODE, kind });
     }
-    funcNode->children.push_back(body);
-
-    return funcNode;
+    bodies.push_back({ owner, ast.addNode(ASTNodeType::BLOCK, ATOM_BLOCK, offset), kind });
+    return kOpenedBody;
 }
 
-std::shared_ptr<ASTNode> Parser::parseBlock() {
-    if (!matchToken("{")) {
-        std::cerr << "err: waiting '{' \n";
-        return nullptr;
+// Attaches a closed (or missing) body to its statement.
+NodeId Parser::finishBody(const OpenBody& body) {
+    switch (body.kind) {
+        case OPEN_FUNCTION:
+            if (body.block == INVALID_NODE) {
+                error() << "err: waiting function torsio\n";
+                return INVALID_NODE;
+            }
+            ast.appendChild(body.owner, body.block);
+            return body.owner;
+        case OPEN_THEN:
+            if (body.block != INVALID_NODE) ast.appendChild(body.owner, body.block);
+            if (currentAtom() == ATOM_ELSE) {
+                advance();
+                return openBody(body.owner, OPEN_ELSE);
+            }
+            return body.owner;
+        case OPEN_ELSE:
+        case OPEN_WHILE:
+            if (body.block != INVALID_NODE) ast.appendChild(body.owner, body.block);
+            return body.owner;
+        default:
+            return body.block;
     }
+}
 
-    auto blockNode = std::make_shared<ASTNode>(ASTNodeType::BLOCK, "block");
-
-    while (!isAtEnd() && peek().value != "}") {
-        auto stmt = parseStatement();
-        if (stmt) {
-            blockNode->children.push_back(stmt);
-        } else {
-            advance();
-        }
+NodeId Parser::parseFunctionDeclaration() {
+    advance();
+    if (currentType() != TokenType::IDENTIFIER) {
+        error() << "err: waiting function nanme\n";
+        return INVALID_NODE;
     }
+    Atom funcName = currentAtom();
+    // The name is what a source map needs to point at.
+    uint32_t nameOffset = currentOffset();
+    advance();
+    if (!matchToken(ATOM_LPAREN)) {
+        error() << "err: waiting '('for function parameter\n";
+        return INVALID_NODE;
+    }
+    auto funcNode = ast.addNode(ASTNodeType::FUNCTION_DECLARATION, funcName, nameOffset);
+    while (!isAtEnd() && currentAtom() != ATOM_RPAREN) {
+        if (currentType() != TokenType::IDENTIFIER) {
+            error() << "err: waiting parameter name\n";
+            return INVALID_NODE;
+        }
+        auto param = ast.addNode(ASTNodeType::IDENTIFIER, currentAtom(), currentOffset());
+        ast.appendChild(funcNode, param);
+        advance();
 
-    if (!matchToken("}")) {
-        std::cerr << "err: waiting '}' \n";
+        matchToken(ATOM_COMMA);
+    }
+    if (!matchToken(ATOM_RPAREN)) {
+        error() << "err: waiting ')'\n";
+        return INVALID_NODE;
     }
 
-    return blockNode;
+    return openBody(funcNode, OPEN_FUNCTION);
 }
 
-std::shared_ptr<ASTNode> Parser::parseIfStatement() {
+NodeId Parser::parseIfStatement() {
+    uint32_t offset = currentOffset();
     advance();
 
-    if (!matchToken("(")) {
-        std::cerr << "err: waiting '(' for if condition\n";
-        return nullptr;
+    if (!matchToken(ATOM_LPAREN)) {
+        error() << "err: waiting '(' for if condition\n";
+        return INVALID_NODE;
     }
 
     auto condition = parseExpression();
 
-    if (!matchToken(")")) {
-        std::cerr << "err: waitin ')' for if condition\n";
-        return nullptr;
+    if (!matchToken(ATOM_RPAREN)) {
+        error() << "err: waitin ')' for if condition\n";
+        return INVALID_NODE;
     }
 
-    auto ifNode = std::make_shared<ASTNode>(ASTNodeType::IF_STATEMENT, "if");
-    ifNode->children.push_back(condition);
+    auto ifNode = ast.addNode(ASTNodeType::IF_STATEMENT, ATOM_IF, offset);
+    ast.appendChild(ifNode, condition);
 
-    auto thenBlock = parseBlock();
-    if (thenBlock) ifNode->children.push_back(thenBlock);
-
-    if (!isAtEnd() && peek().value == "else") {
-        advance();
-        auto elseBlock = parseBlock();
-        if (elseBlock) ifNode->children.push_back(elseBlock);
-    }
-
-    return ifNode;
+    return openBody(ifNode, OPEN_THEN);
 }
 
-std::shared_ptr<ASTNode> Parser::parseWhileStatement() {
+NodeId Parser::parseWhileStatement() {
+    uint32_t offset = currentOffset();
     advance();
 
-    if (!matchToken("(")) {
-        std::cerr << "err: waiting '(' for while condifiton\n";
-        return nullptr;
+    if (!matchToken(ATOM_LPAREN)) {
+        error() << "err: waiting '(' for while condifiton\n";
+        return INVALID_NODE;
     }
 
     auto condition = parseExpression();
 
-    if (!matchToken(")")) {
-        std::cerr << "err: waiting ')' for while condition\n";
-        return nullptr;
+    if (!matchToken(ATOM_RPAREN)) {
+        error() << "err: waiting ')' for while condition\n";
+        return INVALID_NODE;
     }
 
-    auto whileNode = std::make_shared<ASTNode>(ASTNodeType::WHILE_STATEMENT, "while");
-    whileNode->children.push_back(condition);
+    auto whileNode = ast.addNode(ASTNodeType::WHILE_STATEMENT, ATOM_WHILE, offset);
+    ast.appendChild(whileNode, condition);
 
-    auto body = parseBlock();
-    if (body) whileNode->children.push_back(body);
-
-    return whileNode;
+    return openBody(whileNode, OPEN_WHILE);
 }
 
-std::shared_ptr<ASTNode> Parser::parseVariableDeclaration() {
-    std::string kind = peek().value;
+NodeId Parser::parseVariableDeclaration() {
+    uint32_t offset = currentOffset();
     advance();
-    if (isAtEnd() || peek().type != TokenType::IDENTIFIER) {
-        std::cerr << "Hata: Degişken ismi bekleniyor\n";
-        return nullptr;
+    if (currentType() != TokenType::IDENTIFIER) {
+        error() << "Hata: Degişken ismi bekleniyor\n";
+        return INVALID_NODE;
     }
 
-    std::string varName = peek().value;
+    Atom varName = currentAtom();
     advance();
 
-    std::shared_ptr<ASTNode> initExpr = nullptr;
+    NodeId initExpr = INVALID_NODE;
 
-    if (!isAtEnd() && peek().value == "=") {
+    if (currentAtom() == ATOM_ASSIGN) {
         advance();
-        initExpr = parseExpression();
+        initExpr = parseExpression(false);
     }
 
-    if (!isAtEnd() && peek().value == ";") {
-        advance();
-    }
+    matchToken(ATOM_SEMICOLON);
 
-    auto varDeclNode = std::make_shared<ASTNode>(ASTNodeType::VARIABLE_DECLARATION, varName);
-    if (initExpr) varDeclNode->children.push_back(initExpr);
+    auto varDeclNode = ast.addNode(ASTNodeType::VARIABLE_DECLARATION, varName, offset);
+    if (initExpr != INVALID_NODE) ast.appendChild(varDeclNode, initExpr);
 
     return varDeclNode;
 }
-std::shared_ptr<ASTNode> Parser::parseFunctionCall(std::shared_ptr<ASTNode> callee) {
-    if (!matchToken("(")) {
-        std::cerr << "err: waiting '(' for func calling\n";
-        return nullptr;
-    }
-
-    std::string callValue = callee->value;
-    if (callee->type == ASTNodeType::MEMBER_EXPRESSION) {
-        callValue = callee->children[1]->value;
-    }
-
-    auto callNode = std::make_shared<ASTNode>(ASTNodeType::FUNCTION_CALL, callValue);
-    callNode->children.push_back(callee);
-
-    int argIndex = 0;
+NodeId Parser::parseForLoop() {
+    uint32_t offset = currentOffset();
+    if (!matchToken(ATOM_FOR)) return INVALID_NODE;
 
-    while (!isAtEnd() && peek().value != ")") {
-        auto arg = parseExpression();
-        if (!arg) {
-            std::cerr << "err: Unexpected argument at index " << argIndex << "\n";
-            break;
-        }
-        callNode->children.push_back(arg);
-        argIndex++;
-
-        if (peek().value == ",") {
-            advance();
-        } else if (peek().value != ")") {
-            std::cerr << "err: waiting ',' or ')' after argument at index " << argIndex << "\n";
-            break;
-        }
+    if (!matchToken(ATOM_LPAREN)) {
+        error() << "err: waiting '(' for for-loop\n";
+        return INVALID_NODE;
     }
 
-    if (!matchToken(")")) {
-        std::cerr << "err: waiting ')' for func calling \n";
-        return nullptr;
-    }
-
-    if (!isAtEnd() && peek().value == ";") {
-        advance();
-    }
-
-    return callNode;
-}
-
-std::shared_ptr<ASTNode> Parser::parseForLoop() {
-    if (!matchToken("for")) return nullptr;
-
-    if (!matchToken("(")) {
-        std::cerr << "err: waiting '(' for for-loop\n";
-        return nullptr;
-    }
-
-    auto forNode = std::make_shared<ASTNode>(ASTNodeType::FOR_LOOP, "for");
+    auto forNode = ast.addNode(ASTNodeType::FOR_LOOP, ATOM_FOR, offset);
 
     auto init = parseStatement();
-    if (!init) {
-        std::cerr << "err: Invalid initialization statement in for-loop\n";
-        return nullptr;
+    if (init == INVALID_NODE) {
+        error() << "err: Invalid initialization statement in for-loop\n";
+        return INVALID_NODE;
     }
-    forNode->children.push_back(init);
+    ast.appendChild(forNode, init);
 
     auto condition = parseExpression();
-    if (!condition) {
-        std::cerr << "err: Invalid condition in for-loop\n";
-        return nullptr;
+    if (condition == INVALID_NODE) {
+        error() << "err: Invalid condition in for-loop\n";
+        return INVALID_NODE;
     }
-    forNode->children.push_back(condition);
+    ast.appendChild(forNode, condition);
 
-    if (!matchToken(";")) {
-        std::cerr << "err: waiting ';' after for-loop condition\n";
-        return nullptr;
+    if (!matchToken(ATOM_SEMICOLON)) {
+        error() << "err: waiting ';' after for-loop condition\n";
+        return INVALID_NODE;
     }
 
     auto increment = parseStatement();
-    if (!increment) {
-        std::cerr << "err: Invalid increment statement in for-loop\n";
-        return nullptr;
+    if (increment == INVALID_NODE) {
+        error() << "err: Invalid increment statement in for-loop\n";
+        return INVALID_NODE;
     }
-    forNode->children.push_back(increment);
+    ast.appendChild(forNode, increment);
 
-    if (!matchToken(")")) {
-        std::cerr << "err: waiting ')' after for-loop increment\n";
-        return nullptr;
+    if (!matchToken(ATOM_RPAREN)) {
+        error() << "err: waiting ')' after for-loop increment\n";
+        return INVALID_NODE;
     }
 
     auto body = parseBlock();
-    if (!body) {
-        std::cerr << "err: Invalid block in for-loop\n";
-        return nullptr;
+    if (body == INVALID_NODE) {
+        error() << "err: Invalid block in for-loop\n";
+        return INVALID_NODE;
     }
-    forNode->children.push_back(body);
+    ast.appendChild(forNode, body);
 
     return forNode;
 }
 
-std::shared_ptr<ASTNode> Parser::parseWhileLoop() {
-    if (!matchToken("while")) return nullptr;
+NodeId Parser::parseWhileLoop() {
+    uint32_t offset = currentOffset();
+    if (!matchToken(ATOM_WHILE)) return INVALID_NODE;
 
-    if (!matchToken("(")) {
-        std::cerr << "err: waiting '(' for while-loop\n";
-        return nullptr;
+    if (!matchToken(ATOM_LPAREN)) {
+        error() << "err: waiting '(' for while-loop\n";
+        return INVALID_NODE;
     }
 
-    auto whileNode = std::make_shared<ASTNode>(ASTNodeType::WHILE_LOOP, "while");
+    auto whileNode = ast.addNode(ASTNodeType::WHILE_LOOP, ATOM_WHILE, offset);
 
     auto condition = parseExpression();
-    if (!condition) {
-        std::cerr << "err: Invalid condition in while-loop\n";
-        return nullptr;
+    if (condition == INVALID_NODE) {
+        error() << "err: Invalid condition in while-loop\n";
+        return INVALID_NODE;
     }
-    whileNode->children.push_back(condition);
+    ast.appendChild(whileNode, condition);
 
-    if (!matchToken(")")) {
-        std::cerr << "err: waiting ')' after while-loop condition\n";
-        return nullptr;
+    if (!matchToken(ATOM_RPAREN)) {
+        error() << "err: waiting ')' after while-loop condition\n";
+        return INVALID_NODE;
     }
 
     auto body = parseBlock();
-    if (!body) {
-        std::cerr << "err: Invalid block in while-loop\n";
-        return nullptr;
+    if (body == INVALID_NODE) {
+        error() << "err: Invalid block in while-loop\n";
+        return INVALID_NODE;
     }
-    whileNode->children.push_back(body);
+    ast.appendChild(whileNode, body);
 
     return whileNode;
 }
 
-std::shared_ptr<ASTNode> Parser::parseReturnStatement() {
+NodeId Parser::parseReturnStatement() {
+    uint32_t offset = currentOffset();
     advance();
     auto expr = parseExpression();
 
-    if (!isAtEnd() && peek().value == ";") {
-        advance();
-    }
+    matchToken(ATOM_SEMICOLON);
 
-    auto returnNode = std::make_shared<ASTNode>(ASTNodeType::RETURN_STATEMENT, "return");
-    if (expr) returnNode->children.push_back(expr);
+    auto returnNode = ast.addNode(ASTNodeType::RETURN_STATEMENT, ATOM_RETURN, offset);
+    if (expr != INVALID_NODE) ast.appendChild(returnNode, expr);
 
     return returnNode;
 }
 
-std::shared_ptr<ASTNode> Parser::parseExpression() {
-    auto left = parseTerm();
-
-    while (!isAtEnd() && (peek().value == "+" || peek().value == "-")) {
-        std::string op = peek().value;
-        advance();
-
-        auto right = parseTerm();
-        if (!right) {
-            std::cerr << "err: waiting right operand\n";
-            return left;
+// Precedence climbing over an explicit stack. The loop alternates between
+// operand position (prefix operators, '(' and primaries) and operator
+// position (member access, calls, postfix, binary and conditional
+// operators). Nesting pushes onto pending instead of recursing, so depth
+// costs heap, not C++ frames, and parse time is linear in the token count.
+NodeId Parser::parseExpression(bool sequence) {
+    const size_t base = pending.size();
+    NodeId operand = INVALID_NODE;
+    for (;;) {
+        // Operand position.
+        Atom atom = currentAtom();
+        operand = INVALID_NODE;
+        switch (currentType()) {
+            case TokenType::END:
+                return unwindExpression(base, INVALID_NODE);
+            case TokenType::NUMBER:
+                operand = ast.addNode(ASTNodeType::NUMBER, atom, currentOffset());
+                break;
+            case TokenType::STRING:
+                operand = ast.addNode(ASTNodeType::STRING, atom, currentOffset());
+                break;
+            case TokenType::IDENTIFIER:
+                operand = ast.addNode(ASTNodeType::IDENTIFIER, atom, currentOffset());
+                break;
+            case TokenType::OPERATOR:
+                if (!isPrefixOperator(atom)) break;
+                pending.push_back({ PENDING_PREFIX, PREC_PREFIX, atom, INVALID_NODE, INVALID_NODE, currentOffset() });
+                advance();
+                continue;
+            default:
+                if (atom != ATOM_LPAREN) break;
+                advance();
+                pending.push_back({ PENDING_PAREN, PREC_NONE, ATOM_LPAREN, INVALID_NODE, INVALID_NODE, kNoSourceOffset });
+                continue;
         }
-
-        auto exprNode = std::make_shared<ASTNode>(ASTNodeType::EXPRESSION, op);
-        exprNode->children.push_back(left);
-        exprNode->children.push_back(right);
-        left = exprNode;
-    }
-
-    return left;
-}
-
-std::shared_ptr<ASTNode> Parser::parseTerm() {
-    auto left = parseFactor();
-
-    while (!isAtEnd() && (peek().value == "*" || peek().value == "/")) {
-        std::string op = peek().value;
-        advance();
-
-        auto right = parseFactor();
-        if (!right) {
-            std::cerr << "err: waiting right operand\n";
-            return left;
+        if (operand == INVALID_NODE) {
+            error() << "err: unexpected token: " << peek().value << "\n";
+            skipToken();
+            return unwindExpression(base, INVALID_NODE);
         }
-
-        auto exprNode = std::make_shared<ASTNode>(ASTNodeType::EXPRESSION, op);
-        exprNode->children.push_back(left);
-        exprNode->children.push_back(right);
-        left = exprNode;
-    }
-
-    return left;
-}
-
-std::shared_ptr<ASTNode> Parser::parseFactor() {
-    return parseMemberExpression();
-}
-
-std::shared_ptr<ASTNode> Parser::parseMemberExpression() {
-    auto object = parsePrimary();
-
-    while (!isAtEnd() && peek().value == ".") {
         advance();
 
-        if (isAtEnd() || peek().type != TokenType::IDENTIFIER) {
-            std::cerr << "err: waaiting identifier\n";
-            return object;
+        // Operator position; breaking out goes back to operand position.
+        for (;;) {
+            if (isAtEnd()) return unwindExpression(base, operand);
+            TokenType type = currentType();
+            Atom op = currentAtom();
+            if (op == ATOM_DOT) {
+                advance();
+                if (currentType() != TokenType::IDENTIFIER) {
+                    error() << "err: waaiting identifier\n";
+                    continue;
+                }
+                auto property = ast.addNode(ASTNodeType::IDENTIFIER, currentAtom(), currentOffset());
+                advance();
+                auto memberNode = ast.addNode(ASTNodeType::MEMBER_EXPRESSION, ATOM_DOT, ast.sourceOffset(operand));
+                ast.appendChild(memberNode, operand);
+                ast.appendChild(memberNode, property);
+                operand = memberNode;
+                continue;
+            }
+            if (op == ATOM_LPAREN) {
+                advance();
+                Atom callValue = ast[operand].value;
+                if (ast[operand].type == ASTNodeType::MEMBER_EXPRESSION) {
+                    callValue = ast[ast[operand].lastChild].value;
+                }
+                auto callNode = ast.addNode(ASTNodeType::FUNCTION_CALL, callValue, ast.sourceOffset(operand));
+                ast.appendChild(callNode, operand);
+                operand = callNode;
+                if (matchToken(ATOM_RPAREN)) continue;
+                pending.push_back({ PENDING_CALL, PREC_NONE, ATOM_LPAREN, callNode, INVALID_NODE, kNoSourceOffset });
+                break;
+            }
+            if (type != TokenType::OPERATOR && op != ATOM_COMMA && op != ATOM_RPAREN) {
+                return unwindExpression(base, operand);
+            }
+            if (op == ATOM_INCREMENT || op == ATOM_DECREMENT) {
+                advance();
+                auto postfixNode = ast.addNode(ASTNodeType::POSTFIX_EXPRESSION, op, ast.sourceOffset(operand));
+                ast.appendChild(postfixNode, operand);
+                operand = postfixNode;
+                continue;
+            }
+            if (op == ATOM_QUESTION) {
+                advance();
+                operand = reduceOperators(base, operand, PREC_CONDITIONAL, true);
+                pending.push_back({ PENDING_THEN, PREC_NONE, ATOM_QUESTION, operand, INVALID_NODE, kNoSourceOffset });
+                break;
+            }
+            uint8_t precedence = binaryPrecedence(op);
+            if (op == ATOM_COMMA && !startsSequence(base, sequence)) precedence = PREC_NONE;
+            if (precedence != PREC_NONE) {
+                advance();
+                operand = reduceOperators(base, operand, precedence, precedence == PREC_ASSIGN);
+                pending.push_back({ PENDING_BINARY, precedence, op, operand, INVALID_NODE, kNoSourceOffset });
+                break;
+            }
+
+            // ':', ',' and ')' close the innermost group; anything else, or a
+            // closer with no group open, ends the expression.
+            operand = reduceOperators(base, operand, PREC_NONE, true);
+            // Only groups are left above base now; PENDING_BINARY means none.
+            uint8_t open = PENDING_BINARY;
+            if (pending.size() > base) open = pending.back().kind;
+            if (op == ATOM_COLON && open == PENDING_THEN) {
+                advance();
+                PendingOp& branch = pending.back();
+                branch.kind = PENDING_ELSE;
+                branch.precedence = PREC_BRANCH;
+                branch.middle = operand;
+                break;
+            }
+            if (op == ATOM_COMMA && open == PENDING_CALL) {
+                advance();
+                ast.appendChild(pending.back().left, operand);
+                break;
+            }
+            if (op == ATOM_RPAREN && open == PENDING_PAREN) {
+                advance();
+                pending.pop_back();
+                continue;
+            }
+            if (op == ATOM_RPAREN && open == PENDING_CALL) {
+                advance();
+                ast.appendChild(pending.back().left, operand);
+                operand = pending.back().left;
+                pending.pop_back();
+                continue;
+            }
+            return unwindExpression(base, operand);
         }
-
-        auto property = std::make_shared<ASTNode>(ASTNodeType::IDENTIFIER, peek().value);
-        advance();
-
-        auto memberNode = std::make_shared<ASTNode>(ASTNodeType::MEMBER_EXPRESSION, ".");
-        memberNode->children.push_back(object);
-        memberNode->children.push_back(property);
-
-        if (!isAtEnd() && peek().value == "(") {
-            return parseFunctionCall(memberNode);
-        }
-
-        object = memberNode;
     }
-
-    return object;
 }
 
-std::shared_ptr<ASTNode> Parser::parsePrimary() {
-    if (isAtEnd()) return nullptr;
-
-    const Token& token = peek();
-
-    if (token.type == TokenType::NUMBER) {
-        auto node = std::make_shared<ASTNode>(ASTNodeType::NUMBER, token.value);
-        advance();
-        return node;
+// A comma is the sequence operator unless the innermost open group is a
+// call, whose arguments it separates, or no group is open and the
+// expression takes no sequence.
+bool Parser::startsSequence(size_t base, bool sequence) const {
+    for (size_t i = pending.size(); i > base; --i) {
+        if (pending[i - 1].precedence == PREC_NONE) return pending[i - 1].kind != PENDING_CALL;
     }
+    return sequence;
+}
 
-    if (token.type == TokenType::STRING) {
-        auto node = std::make_shared<ASTNode>(ASTNodeType::STRING, token.value);
-        advance();
-        return node;
+// Builds the node for an operator whose right operand is complete. A missing
+// operand drops the operator and keeps what came before it.
+NodeId Parser::applyPending(const PendingOp& entry, NodeId operand) {
+    if (operand == INVALID_NODE) {
+        if (entry.kind == PENDING_BINARY) error() << "err: waiting right operand\n";
+        return entry.kind == PENDING_PREFIX ? INVALID_NODE : entry.left;
+    }
+    NodeId node = INVALID_NODE;
+    switch (entry.kind) {
+        case PENDING_BINARY:
+            node = ast.addNode(ASTNodeType::EXPRESSION, entry.op, ast.sourceOffset(entry.left));
+            ast.appendChild(node, entry.left);
+            ast.appendChild(node, operand);
+            break;
+        case PENDING_PREFIX:
+            node = ast.addNode(ASTNodeType::UNARY_EXPRESSION, entry.op, entry.offset);
+            ast.appendChild(node, operand);
+            break;
+        default:
+            node = ast.addNode(ASTNodeType::CONDITIONAL_EXPRESSION, ATOM_QUESTION, ast.sourceOffset(entry.left));
+            ast.appendChild(node, entry.left);
+            ast.appendChild(node, entry.middle);
+            ast.appendChild(node, operand);
+            break;
     }
+    return node;
+}
 
-    if (token.type == TokenType::IDENTIFIER) {
-        auto node = std::make_shared<ASTNode>(ASTNodeType::IDENTIFIER, token.value);
-        advance();
-        if (!isAtEnd() && peek().value == "(") {
-            return parseFunctionCall(node);
+// Applies pending operators above base that bind tighter than precedence
+// (or as tight, for left-associative operators). Groups stop the scan.
+NodeId Parser::reduceOperators(size_t base, NodeId operand, uint8_t precedence, bool rightAssoc) {
+    while (pending.size() > base) {
+        const PendingOp& top = pending.back();
+        if (top.precedence < precedence || (top.precedence == precedence && rightAssoc) ||
+            top.precedence == PREC_NONE) {
+            break;
         }
-        return node;
+        operand = applyPending(top, operand);
+        pending.pop_back();
     }
+    return operand;
+}
 
-    if (token.value == "(") {
-        advance();
-        auto expr = parseExpression();
-        if (!expr) {
-            std::cerr << "err: unknown val\n";
-            return nullptr;
-        }
-        if (!matchToken(")")) {
-            std::cerr << "err: waiting ')'\n";
-            return nullptr;
+// Ends the expression, closing any groups the input left open.
+NodeId Parser::unwindExpression(size_t base, NodeId operand) {
+    for (;;) {
+        operand = reduceOperators(base, operand, PREC_NONE, true);
+        if (pending.size() == base) return operand;
+        PendingOp group = pending.back();
+        pending.pop_back();
+        if (group.kind == PENDING_PAREN) {
+            error() << "err: waiting ')'\n";
+        } else if (group.kind == PENDING_CALL) {
+            error() << "err: waiting ')' for func calling \n";
+            if (operand != INVALID_NODE) ast.appendChild(group.left, operand);
+            operand = group.left;
+        } else {
+            error() << "err: waiting ':'\n";
+            operand = group.left;
         }
-        return expr;
     }
-
-    std::cerr << "err: unexpected token: " << token.value << "\n";
-    advance();
-    return nullptr;
 }
-std::shared_ptr<ASTNode> Parser::parseString() {
-    if (isAtEnd() || peek().type != TokenType::STRING) {
-        return nullptr;
+
+NodeId Parser::parseString() {
+    if (currentType() != TokenType::STRING) {
+        return INVALID_NODE;
     }
     
-    auto node = std::make_shared<ASTNode>(ASTNodeType::STRING, peek().value);
+    auto node = ast.addNode(ASTNodeType::STRING, currentAtom(), currentOffset());
     advance();
     
-    while (!isAtEnd() && peek().value == "+") {
+    while (currentAtom() == ATOM_PLUS) {
         advance();
-        if (isAtEnd() || peek().type != TokenType::STRING) {
-            std::cerr << "Error: Expected string after '+' for concatenation\n";
+        if (currentType() != TokenType::STRING) {
+            error() << "Error: Expected string after '+' for concatenation\n";
             return node;
         }
         
-        auto right = std::make_shared<ASTNode>(ASTNodeType::STRING, peek().value);
+        auto right = ast.addNode(ASTNodeType::STRING, currentAtom(), currentOffset());
         advance();
         
-        auto concatNode = std::make_shared<ASTNode>(ASTNodeType::BINARY_EXPRESSION, "+");
-        concatNode->children.push_back(node);
-        concatNode->children.push_back(right);
+        auto concatNode = ast.addNode(ASTNodeType::BINARY_EXPRESSION, ATOM_PLUS, ast.sourceOffset(node));
+        ast.appendChild(concatNode, node);
+        ast.appendChild(concatNode, right);
         node = concatNode;
     }
     
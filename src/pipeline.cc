@@ -0,0 +1,180 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 13:40:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 13:40:00 
+ */
+#include "pipeline.h"
+#include <optional>
+#include <utility>
+#include "ast_file.h"
+#include "background_lexer.h"
+#include "constant_folder.h"
+#include "parser.h"
+#include "source_map.h"
+#include "stats.h"
+#include "thread_pool.h"
+
+namespace {
+
+// Inputs at least this large are lexed on a thread of their own while the
+// parser runs, when the context has a pool to say threads are welcome.
+// Smaller ones finish before the thread would pay for itself.
+constexpr size_t kBackgroundLexBytes = 1 << 20;
+
+#if CURSIOBFUSCATOR_STATS
+// Times the parser's pulls, which are lexing (or, with a background lexer,
+// waiting for it) rather than parsing.
+class TimedTokenSource final : public TokenSource {
+public:
+    explicit TimedTokenSource(TokenSource& source) : source(source) {}
+
+    size_t fill(const TokenSlots& out, size_t max) override {
+        PhaseTimer timer(&pulls, PHASE_TOKENIZE);
+        return source.fill(out, max);
+    }
+    std::string_view text() const override { return source.text(); }
+    size_t sizeHint() const override { return source.sizeHint(); }
+
+    // Moves the pull time out of the parse phase it was measured in.
+    void book(RunStats& stats) const {
+        stats.wallMs[PHASE_TOKENIZE] += pulls.wallMs[PHASE_TOKENIZE];
+        stats.wallMs[PHASE_PARSE] -= pulls.wallMs[PHASE_TOKENIZE];
+        stats.cpuMs[PHASE_TOKENIZE] += pulls.cpuMs[PHASE_TOKENIZE];
+        stats.cpuMs[PHASE_PARSE] -= pulls.cpuMs[PHASE_TOKENIZE];
+    }
+
+private:
+    TokenSource& source;
+    RunStats pulls;
+};
+#endif
+
+} // namespace
+
+ObfuscationContext::ObfuscationContext(ThreadPool* pool, const ObfuscatorOptions& options)
+    : pool(pool), obfuscator(atoms, pool, options) {}
+
+void ObfuscationContext::reset() {
+    obfuscator.reset();
+    ast.clear();
+    atoms.reset();
+}
+
+const std::string& ObfuscationContext::run(std::string_view source, const AstInspector& inspect,
+                                           RunStats* stats, SourceMap* sourceMap) {
+    parse(source, stats, sourceMap ? &sourceMap->lines : nullptr);
+    return obfuscate(inspect, stats, sourceMap);
+}
+
+void ObfuscationContext::parse(std::string_view source, RunStats* stats, SourceLines* lines) {
+#if !CURSIOBFUSCATOR_STATS
+    (void)stats;
+#endif
+    reset();
+    output.clear();
+    Lexer lexer(source, atoms);
+    std::vector<uint32_t> lineStarts;
+    if (lines) lexer.recordLineStarts(&lineStarts);
+    TokenSource* tokens = &lexer;
+    // The background lexer interns into atoms until the parser has drained
+    // it, so it must be gone before anything else reads the table.
+    std::optional<BackgroundLexer> background;
+    if (pool && pool->size() > 1 && source.size() >= kBackgroundLexBytes) {
+        background.emplace(lexer);
+        tokens = &*background;
+        // Process CPU time now covers two threads at once.
+        OBF_STAT(if (stats) stats->phaseCpu = false;)
+    }
+#if CURSIOBFUSCATOR_STATS
+    TimedTokenSource timed(*tokens);
+    if (stats) tokens = &timed;
+    ParserStats parserStats;
+#endif
+    {
+        Parser parser(*tokens, ast);
+        {
+            OBF_STAT(PhaseTimer timer(stats, PHASE_PARSE);)
+            parser.parseProgram();
+        }
+        OBF_STAT(parserStats = parser.statistics();)
+    }
+    background.reset();
+    if (lines) lines->reset(std::move(lineStarts));
+
+#if CURSIOBFUSCATOR_STATS
+    if (stats) {
+        timed.book(*stats);
+        stats->bytesIn += source.size();
+        const LexerStats& lexerStats = lexer.statistics();
+        for (size_t t = 0; t < kTokenTypeCount; ++t) stats->tokens[t] += lexerStats.tokens[t];
+        stats->lexer.unknownTokens += lexerStats.unknownTokens;
+        stats->lexer.whitespaceRuns += lexerStats.whitespaceRuns;
+        stats->parser.errors += parserStats.errors;
+        stats->parser.skippedTokens += parserStats.skippedTokens;
+    }
+#endif
+}
+
+// Loading stands in for parsing in the statistics.
+bool ObfuscationContext::load(std::string_view data, ASTFileSource& source, std::string& error, RunStats* stats) {
+#if !CURSIOBFUSCATOR_STATS
+    (void)stats;
+#endif
+    reset();
+    output.clear();
+    OBF_STAT(if (stats) stats->bytesIn += data.size();)
+    OBF_STAT(PhaseTimer timer(stats, PHASE_PARSE);)
+    return readASTFile(data, ast, atoms, source, error);
+}
+
+void ObfuscationContext::save(std::string_view source, std::string_view sourcePath, std::string& out) const {
+    writeASTFile(ast, atoms, source, sourcePath, out);
+}
+
+const std::string& ObfuscationContext::obfuscate(const AstInspector& inspect, RunStats* stats,
+                                                 SourceMap* sourceMap) {
+#if !CURSIOBFUSCATOR_STATS
+    (void)stats;
+#endif
+    size_t folded = 0;
+    {
+        OBF_STAT(PhaseTimer timer(stats, PHASE_OBFUSCATE);)
+        folded = foldConstants(ast, atoms);
+        obfuscator.obfuscate(ast);
+    }
+    // Code generation adds the string-table helper names, so read the
+    // rename count first.
+    OBF_STAT(size_t renamedNames = obfuscator.renamedCount();)
+    if (inspect) {
+        OBF_STAT(PhaseTimer timer(stats, PHASE_DUMP);)
+        inspect(ast, atoms);
+    }
+
+    {
+        OBF_STAT(PhaseTimer timer(stats, PHASE_GENERATE);)
+        obfuscator.generateObfuscatedCode(ast, output, sourceMap);
+    }
+
+#if CURSIOBFUSCATOR_STATS
+    if (stats) {
+        stats->countNodes(ast);
+        stats->bytesOut += output.size();
+        stats->atoms += atoms.size();
+        stats->renamedNames += renamedNames;
+        stats->foldedExpressions += folded;
+        stats->stringTableEntries += obfuscator.stringTableSize();
+    }
+#else
+    (void)folded;
+#endif
+    return output;
+}
+
+std::string obfuscateSource(std::string_view source, ThreadPool* pool,
+                            const AstInspector& inspect, RunStats* stats, const ObfuscatorOptions& options,
+                            SourceMap* sourceMap) {
+    ObfuscationContext context(pool, options);
+    context.run(source, inspect, stats, sourceMap);
+    return context.takeOutput();
+}
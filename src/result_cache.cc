@@ -0,0 +1,180 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 12:30:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 12:30:00 
+ */
+#include "result_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+#include "file_io.h"
+#include "hash.h"
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bump whenever the code generated for the same input and options changes,
+// so results from older builds are never served.
+constexpr std::string_view kCacheVersion = "cursiobfuscator-cache-6";
+constexpr std::string_view kEntrySuffix = ".js";
+constexpr std::string_view kTempPrefix = "tmp-";
+// Running total of the entries' sizes, so evict() only scans the directory
+// once the limit may have been passed.
+constexpr std::string_view kSizeFile = "size";
+// Temporary files older than this were left behind by a crashed writer.
+constexpr auto kStaleTempAge = std::chrono::hours(1);
+
+struct CacheEntry {
+    fs::path path;
+    uintmax_t size;
+    fs::file_time_type lastUse;
+};
+
+bool startsWith(const std::string& s, std::string_view prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool endsWith(const std::string& s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool readSize(const fs::path& path, uintmax_t& size) {
+    std::ifstream in(path);
+    return static_cast<bool>(in >> size);
+}
+
+} // namespace
+
+ResultCache::ResultCache(const std::string& cacheDir, uintmax_t maxSize, const std::string& options)
+    : dir(cacheDir), maxBytes(maxSize) {
+    uintmax_t tracked = 0;
+    trackedBytes = readSize(fs::path(dir) / kSizeFile, tracked) ? tracked : maxBytes;
+    std::string tag(kCacheVersion);
+    tag += '\0';
+    tag += options;
+    seed = xxhash64(tag);
+}
+
+std::string ResultCache::key(std::string_view input) const {
+    // Two independently seeded 64-bit hashes make accidental collisions
+    // between distinct inputs practically impossible.
+    unsigned long long high = xxhash64(input, seed);
+    unsigned long long low = xxhash64(input, ~seed);
+    char text[33];
+    std::snprintf(text, sizeof(text), "%016llx%016llx", high, low);
+    return text;
+}
+
+// Entries fan out over 256 subdirectories to keep each one small.
+std::string ResultCache::entryPath(const std::string& key) const {
+    return (fs::path(dir) / key.substr(0, 2) / (key + std::string(kEntrySuffix))).string();
+}
+
+bool ResultCache::lookup(const std::string& key, InputFile& out) const {
+    std::string path = entryPath(key);
+    if (!out.open(path)) return false;
+    // The modification time doubles as the LRU timestamp.
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    return true;
+}
+
+bool ResultCache::store(const std::string& key, std::string_view output) {
+    fs::path path = entryPath(key);
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    if (ec) return false;
+    // Unique per process and per call, so concurrent writers never share a
+    // temporary file; rename() then publishes the entry atomically.
+    fs::path temp = path.parent_path() / (std::string(kTempPrefix) + std::to_string(getpid()) + "-" +
+                                          std::to_string(tempCounter.fetch_add(1)) + "-" + key);
+    if (!writeOutput(temp.string(), output)) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return false;
+    }
+    uintmax_t stored = storedBytes.fetch_add(output.size()) + output.size();
+    return trackedBytes.load() + stored > maxBytes;
+}
+
+std::string ResultCache::tempPath(const std::string& name) {
+    return (fs::path(dir) / (std::string(kTempPrefix) + std::to_string(getpid()) + "-" +
+                             std::to_string(tempCounter.fetch_add(1)) + "-" + name)).string();
+}
+
+// Like entries, the total is replaced by a rename. Runs that race may lose
+// each other's additions; the next scan puts the total right.
+void ResultCache::writeSize(uintmax_t size) {
+    std::string temp = tempPath(std::string(kSizeFile));
+    std::error_code ec;
+    if (!writeOutput(temp, std::to_string(size))) {
+        fs::remove(temp, ec);
+        return;
+    }
+    fs::rename(temp, fs::path(dir) / kSizeFile, ec);
+    if (ec) fs::remove(temp, ec);
+}
+
+void ResultCache::evict() {
+    std::lock_guard<std::mutex> lock(evictMutex);
+    uintmax_t stored = storedBytes.exchange(0);
+    if (stored == 0) return;
+    // Scan only when the total is missing or now over the limit.
+    uintmax_t tracked = 0;
+    if (readSize(fs::path(dir) / kSizeFile, tracked) && tracked + stored <= maxBytes) {
+        writeSize(tracked + stored);
+        trackedBytes = tracked + stored;
+        return;
+    }
+
+    std::vector<CacheEntry> entries;
+    uintmax_t total = 0;
+    auto now = fs::file_time_type::clock::now();
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code entryEc;
+        if (!it->is_regular_file(entryEc)) continue;
+        std::string name = it->path().filename().string();
+        fs::file_time_type lastUse = it->last_write_time(entryEc);
+        if (entryEc) continue;
+        if (startsWith(name, kTempPrefix)) {
+            if (now - lastUse > kStaleTempAge) fs::remove(it->path(), entryEc);
+            continue;
+        }
+        if (!endsWith(name, kEntrySuffix)) continue;
+        uintmax_t size = it->file_size(entryEc);
+        if (entryEc) continue;
+        entries.push_back({it->path(), size, lastUse});
+        total += size;
+    }
+    if (total > maxBytes) {
+        std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) {
+            return a.lastUse < b.lastUse;
+        });
+        for (const CacheEntry& entry : entries) {
+            if (total <= maxBytes) break;
+            // Another process may have evicted it already; either way it is gone.
+            fs::remove(entry.path, ec);
+            total -= entry.size;
+        }
+    }
+    writeSize(total);
+    trackedBytes = total;
+}
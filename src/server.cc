@@ -0,0 +1,458 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 14:50:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 14:50:00 
+ */
+#include "server.h"
+#include <iostream>
+
+#ifdef _WIN32
+
+int runServer(const ServerOptions&) {
+    std::cerr << "Error: --serve needs Unix domain sockets, which this platform does not provide" << std::endl;
+    return 1;
+}
+
+bool requestObfuscation(const std::string&, std::string_view, std::string&) {
+    std::cerr << "Error: --client needs Unix domain sockets, which this platform does not provide" << std::endl;
+    return false;
+}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "file_io.h"
+#include "pipeline.h"
+#include "result_cache.h"
+#include "thread_pool.h"
+
+namespace {
+
+// The lexer addresses tokens with 32-bit offsets.
+constexpr uint64_t kMaxRequestBytes = UINT32_MAX;
+// Initial request buffer per worker, so small requests never allocate.
+constexpr size_t kRequestReserve = 64 * 1024;
+// Bodies are read this much at a time.
+constexpr size_t kReadChunk = 1 << 20;
+// Longest a read or write on a connection may block a worker.
+constexpr time_t kIOTimeoutSeconds = 30;
+// Index of the first connection in the accept loop's poll set.
+constexpr size_t kFirstConnection = 3;
+
+// errno is thread-local, but strerror() may share a static buffer.
+std::string errnoMessage() {
+    return std::generic_category().message(errno);
+}
+
+void encodeLength(uint64_t value, unsigned char* out) {
+    for (int i = 0; i < 8; ++i) out[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+uint64_t decodeLength(const unsigned char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    return value;
+}
+
+// Reads exactly size bytes. Returns false on error or end of stream.
+bool readExact(int fd, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Reads a body of size bytes into out. out only grows as the bytes arrive,
+// so a length that is never sent costs no memory.
+bool readBody(int fd, uint64_t size, std::string& out) {
+    out.clear();
+    while (out.size() < size) {
+        size_t begin = out.size();
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(size - begin, kReadChunk));
+        out.resize(begin + chunk);
+        if (!readExact(fd, &out[begin], chunk)) return false;
+    }
+    return true;
+}
+
+bool writeAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool sendResponse(int fd, unsigned char status, std::string_view body) {
+    unsigned char header[9];
+    header[0] = status;
+    encodeLength(body.size(), header + 1);
+    return writeAll(fd, header, sizeof(header)) && writeAll(fd, body.data(), body.size());
+}
+
+bool makeAddress(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: Socket path must be 1 to " << sizeof(addr.sun_path) - 1
+                  << " bytes long: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    return true;
+}
+
+int connectTo(const sockaddr_un& addr) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+// Written by the signal handler to wake the accept loop.
+int stopPipe[2] = { -1, -1 };
+
+extern "C" void onStopSignal(int) {
+    int saved = errno;
+    char byte = 0;
+    (void)!write(stopPipe[1], &byte, 1);
+    errno = saved;
+}
+
+// Per-worker state, created on the first request a worker handles and
+// reused for every request after it.
+struct WorkerState {
+    WorkerState() { request.reserve(kRequestReserve); }
+
+    ObfuscationContext context;
+    std::string request;
+};
+
+class Server {
+public:
+    explicit Server(const ServerOptions& options) : options(options) {}
+
+    ~Server() {
+        for (int fd : wakePipe) {
+            if (fd >= 0) close(fd);
+        }
+    }
+
+    bool start() {
+        if (pipe(wakePipe) != 0) return false;
+        for (int fd : wakePipe) {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+            fcntl(fd, F_SETFL, O_NONBLOCK);
+        }
+        return true;
+    }
+
+    // Readable when connections are waiting in takeReady().
+    int wakeFd() const { return wakePipe[0]; }
+
+    // Reads and answers one request on fd, then hands fd back to the poll
+    // loop, or closes it when the client hung up or broke the protocol.
+    void serveRequest(int fd) {
+        thread_local WorkerState state;
+        bool keep = false;
+        try {
+            state.context.setOptions(options.obfuscator);
+            unsigned char header[8];
+            if (readExact(fd, header, sizeof(header))) {
+                uint64_t size = decodeLength(header);
+                if (size > std::min(options.maxRequestBytes, kMaxRequestBytes)) {
+                    sendResponse(fd, kStatusError, "Request exceeds the server's size limit");
+                } else if (readBody(fd, size, state.request)) {
+                    requests.fetch_add(1, std::memory_order_relaxed);
+                    keep = handleRequest(fd, state);
+                }
+            }
+        } catch (const std::bad_alloc&) {
+            // Give back what the failed request held before the next one.
+            state.request = std::string();
+            sendResponse(fd, kStatusError, "Out of memory");
+        } catch (const std::exception& e) {
+            sendResponse(fd, kStatusError, e.what());
+        }
+        if (keep) {
+            resume(fd);
+        } else {
+            release(fd);
+        }
+    }
+
+    // Moves the connections whose request is done into out.
+    void takeReady(std::vector<int>& out) {
+        char drain[64];
+        while (read(wakePipe[0], drain, sizeof(drain)) > 0) {}
+        std::lock_guard<std::mutex> lock(mutex);
+        out.insert(out.end(), ready.begin(), ready.end());
+        ready.clear();
+    }
+
+    void track(int fd) {
+        std::lock_guard<std::mutex> lock(mutex);
+        open.insert(fd);
+    }
+
+    void release(int fd) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            open.erase(fd);
+        }
+        close(fd);
+    }
+
+    // Lets every request in progress finish, and stops reading new ones.
+    void stop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        for (int fd : open) shutdown(fd, SHUT_RD);
+    }
+
+    // Closes the connections left idle once every worker is done.
+    void closeAll() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int fd : open) close(fd);
+        open.clear();
+        ready.clear();
+    }
+
+    uint64_t requestCount() const { return requests.load(std::memory_order_relaxed); }
+
+private:
+    bool handleRequest(int fd, WorkerState& state) {
+        std::string cacheKey;
+        if (options.cache) {
+            cacheKey = options.cache->key(state.request);
+            InputFile cached;
+            if (options.cache->lookup(cacheKey, cached)) {
+                return sendResponse(fd, kStatusOk, cached.data());
+            }
+        }
+        try {
+            const std::string& code = state.context.run(state.request);
+            bool evict = options.cache && options.cache->store(cacheKey, code);
+            bool sent = sendResponse(fd, kStatusOk, code);
+            // The cache is trimmed while serving, after the response so the
+            // client does not wait on a directory scan.
+            if (evict) options.cache->evict();
+            return sent;
+        } catch (const std::exception& e) {
+            return sendResponse(fd, kStatusError, e.what());
+        }
+    }
+
+    void resume(int fd) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!stopping) {
+                ready.push_back(fd);
+                char byte = 0;
+                (void)!write(wakePipe[1], &byte, 1);
+                return;
+            }
+        }
+        release(fd);
+    }
+
+    const ServerOptions& options;
+    std::atomic<uint64_t> requests{0};
+    int wakePipe[2] = { -1, -1 };
+    std::mutex mutex;
+    std::unordered_set<int> open;
+    std::vector<int> ready;
+    bool stopping = false;
+};
+
+// Binds path, replacing a socket file left behind by a server that is no
+// longer running.
+int listenOn(const std::string& path) {
+    sockaddr_un addr;
+    if (!makeAddress(path, addr)) return -1;
+    struct stat info;
+    if (lstat(path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            std::cerr << "Error: " << path << " exists and is not a socket" << std::endl;
+            return -1;
+        }
+        int probe = connectTo(addr);
+        if (probe >= 0) {
+            close(probe);
+            std::cerr << "Error: A server is already listening on " << path << std::endl;
+            return -1;
+        }
+        unlink(path.c_str());
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+        std::cerr << "Error: Cannot listen on " << path << ": " << errnoMessage() << std::endl;
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+bool installStopHandlers() {
+    if (pipe(stopPipe) != 0) return false;
+    fcntl(stopPipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(stopPipe[1], F_SETFD, FD_CLOEXEC);
+    fcntl(stopPipe[1], F_SETFL, O_NONBLOCK);
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = onStopSignal;
+    sigemptyset(&action.sa_mask);
+    return sigaction(SIGINT, &action, nullptr) == 0 && sigaction(SIGTERM, &action, nullptr) == 0;
+}
+
+} // namespace
+
+int runServer(const ServerOptions& options) {
+    // A client that disconnects mid-response must not kill the server.
+    std::signal(SIGPIPE, SIG_IGN);
+    int listener = listenOn(options.socketPath);
+    if (listener < 0) return 1;
+    if (!installStopHandlers()) {
+        std::cerr << "Error: Cannot install signal handlers: " << errnoMessage() << std::endl;
+        close(listener);
+        unlink(options.socketPath.c_str());
+        return 1;
+    }
+
+    Server server(options);
+    if (!server.start()) {
+        std::cerr << "Error: Cannot create the wake pipe: " << errnoMessage() << std::endl;
+        close(listener);
+        unlink(options.socketPath.c_str());
+        return 1;
+    }
+    size_t threads = options.threads == 0 ? ThreadPool::defaultThreadCount() : options.threads;
+    {
+        // Workers inherit this mask, so the stop signals always reach the
+        // accept loop below.
+        sigset_t stopSignals, previous;
+        sigemptyset(&stopSignals);
+        sigaddset(&stopSignals, SIGINT);
+        sigaddset(&stopSignals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &stopSignals, &previous);
+        ThreadPool pool(threads);
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+        std::cout << "Serving on " << options.socketPath << " with " << threads << " threads" << std::endl;
+        // The listener, the stop pipe, the wake pipe, then the connections
+        // waiting for their next request.
+        std::vector<pollfd> fds = { { listener, POLLIN, 0 }, { stopPipe[0], POLLIN, 0 },
+                                    { server.wakeFd(), POLLIN, 0 } };
+        std::vector<int> resumed;
+        for (;;) {
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Error: poll failed: " << errnoMessage() << std::endl;
+                break;
+            }
+            if (fds[1].revents) break;
+            // Hand each connection with a request to a worker; it comes
+            // back through the wake pipe once the request is answered.
+            size_t kept = kFirstConnection;
+            for (size_t i = kFirstConnection; i < fds.size(); ++i) {
+                int client = fds[i].fd;
+                if (!fds[i].revents) {
+                    fds[kept++] = fds[i];
+                } else if (fds[i].revents & POLLIN) {
+                    pool.submit([&server, client] { server.serveRequest(client); });
+                } else {
+                    server.release(client);
+                }
+            }
+            fds.resize(kept);
+            if (fds[2].revents) {
+                server.takeReady(resumed);
+                for (int client : resumed) fds.push_back({ client, POLLIN, 0 });
+                resumed.clear();
+            }
+            if (!(fds[0].revents & POLLIN)) continue;
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0) continue;
+            fcntl(client, F_SETFD, FD_CLOEXEC);
+            // A client that stalls mid-request or stops reading its
+            // response only holds a worker this long.
+            timeval timeout = { kIOTimeoutSeconds, 0 };
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            server.track(client);
+            fds.push_back({ client, POLLIN, 0 });
+        }
+        close(listener);
+        unlink(options.socketPath.c_str());
+        server.stop();
+        pool.wait();
+        server.closeAll();
+    }
+    // A final sweep for whatever was stored since the last trim.
+    if (options.cache) options.cache->evict();
+    std::cout << "Served " << server.requestCount() << " requests" << std::endl;
+    return 0;
+}
+
+bool requestObfuscation(const std::string& socketPath, std::string_view source, std::string& output) {
+    std::signal(SIGPIPE, SIG_IGN);
+    sockaddr_un addr;
+    if (!makeAddress(socketPath, addr)) return false;
+    int fd = connectTo(addr);
+    if (fd < 0) {
+        std::cerr << "Error: Cannot connect to " << socketPath << ": " << errnoMessage() << std::endl;
+        return false;
+    }
+    unsigned char header[9];
+    encodeLength(source.size(), header);
+    bool ok = writeAll(fd, header, 8) && writeAll(fd, source.data(), source.size()) &&
+              readExact(fd, header, 9);
+    if (ok) ok = readBody(fd, decodeLength(header + 1), output);
+    close(fd);
+    if (!ok) {
+        std::cerr << "Error: Connection to " << socketPath << " failed" << std::endl;
+        return false;
+    }
+    if (header[0] != kStatusOk) {
+        std::cerr << "Error: " << output << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif
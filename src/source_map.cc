@@ -0,0 +1,324 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 18:20:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 18:20:00 
+ */
+#include "source_map.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kBase64Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+// A separator and five VLQ fields of at most 13 digits each.
+constexpr size_t kMaxSegmentBytes = 1 + 5 * 13;
+
+// The VLQ digits of every value below 1024, one or two, then their count.
+struct ShortVlqTable {
+    char text[1024][3] = {};
+
+    constexpr ShortVlqTable() {
+        for (uint32_t bits = 0; bits < 1024; ++bits) {
+            bool twoDigits = bits >= 32;
+            text[bits][0] = kBase64Digits[(bits & 31) | (twoDigits ? 32 : 0)];
+            text[bits][1] = kBase64Digits[bits >> 5];
+            text[bits][2] = twoDigits ? 2 : 1;
+        }
+    }
+};
+
+constexpr ShortVlqTable kShortVlq;
+
+// Sign in the lowest bit, then five bits per digit, least significant
+// first, with 32 marking that more digits follow. Writes at most 13 digits
+// to out and returns the end. Most deltas are small and of either sign, so
+// for those neither the sign nor the digit count costs a branch the CPU
+// has to guess.
+char* writeVlq(char* out, int64_t value) {
+    uint64_t sign = static_cast<uint64_t>(value >> 63);
+    uint64_t bits = (((static_cast<uint64_t>(value) ^ sign) - sign) << 1) | (sign & 1);
+    if (bits < 1024) {
+        std::memcpy(out, kShortVlq.text[bits], 2);
+        return out + kShortVlq.text[bits][2];
+    }
+    do {
+        uint32_t digit = bits & 31;
+        bits >>= 5;
+        if (bits != 0) digit |= 32;
+        *out++ = kBase64Digits[digit];
+    } while (bits != 0);
+    return out;
+}
+
+void appendJsonString(std::string& out, std::string_view text) {
+    static const char kHex[] = "0123456789abcdef";
+    out += '"';
+    for (char ch : text) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (c < 0x20) {
+            out += "\\u00";
+            out += kHex[c >> 4];
+            out += kHex[c & 15];
+        } else {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+void SourceLines::reset(std::vector<uint32_t> starts) {
+    lineStarts = std::move(starts);
+    count = static_cast<uint32_t>(lineStarts.size());
+    lineStarts.push_back(UINT32_MAX);
+}
+
+std::vector<uint32_t> SourceLines::scan(std::string_view text) {
+    std::vector<uint32_t> starts{ 0 };
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    for (const char* p = begin; p < end;) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!newline) break;
+        p = newline + 1;
+        starts.push_back(static_cast<uint32_t>(p - begin));
+    }
+    return starts;
+}
+
+// Most lookups stay on the hinted line. The others double the step away
+// from it until the line is bracketed, then bisect, so a lookup d lines
+// away reads about 2 log d starts.
+void SourceLines::locate(uint32_t offset, uint32_t hint, uint32_t& line, uint32_t& column) const {
+    if (count == 0) {
+        line = 0;
+        column = offset;
+        return;
+    }
+    const uint32_t* starts = lineStarts.data();
+    size_t low = std::min(hint, count - 1);
+    size_t high = low + 1;
+    if (starts[low] <= offset) {
+        // The sentinel stops this at count.
+        for (size_t step = 1; starts[high] <= offset; step *= 2) {
+            low = high;
+            high = std::min(low + step, static_cast<size_t>(count));
+        }
+    } else {
+        // Line 0 starts at 0, so this stops there at the latest.
+        for (size_t step = 1; starts[low] > offset; step *= 2) {
+            high = low;
+            low = low > step ? low - step : 0;
+        }
+    }
+    if (high - low > 1) low = std::upper_bound(starts + low + 1, starts + high, offset) - starts - 1;
+    line = static_cast<uint32_t>(low);
+    column = offset - starts[low];
+}
+
+void MappingEncoder::reset(const SourceLines* sourceLines) {
+    lines = sourceLines;
+    queued.clear();
+    queued.reserve(kBatchSegments);
+    mappings.clear();
+    used = 0;
+    searched = 0;
+    nextBreak = SIZE_MAX;
+    lineStart = 0;
+    lineHasSegment = false;
+    column = 0;
+    sourceLine = 0;
+    sourceColumn = 0;
+    name = 0;
+    hasSegment = false;
+    hasNamed = false;
+}
+
+char* MappingEncoder::reserve(size_t bytes) {
+    if (mappings.size() - used < bytes) mappings.resize(std::max(mappings.size() * 2, used + bytes + 4096));
+    return &mappings[used];
+}
+
+// Every line break becomes a ';', and columns restart with the line. Each
+// search for a break runs on to the end of code, so a break is found once
+// however many segments come before it.
+void MappingEncoder::advance(const std::string& code, size_t position) {
+    const char* begin = code.data();
+    for (;;) {
+        if (nextBreak == SIZE_MAX) {
+            if (searched >= code.size()) break;
+            const void* found = std::memchr(begin + searched, '\n', code.size() - searched);
+            if (!found) {
+                searched = code.size();
+                break;
+            }
+            nextBreak = static_cast<size_t>(static_cast<const char*>(found) - begin);
+        }
+        if (nextBreak >= position) break;
+        *reserve(1) = ';';
+        ++used;
+        lineStart = nextBreak + 1;
+        searched = lineStart;
+        nextBreak = SIZE_MAX;
+        lineHasSegment = false;
+        column = 0;
+    }
+}
+
+// Fields: generated column, source index (always 0: one source), source
+// line, source column and, for named segments, the name.
+char* MappingEncoder::writeSegment(char* out, int64_t columnDelta, int64_t lineDelta, int64_t sourceColumnDelta,
+                                   int64_t nameDelta) {
+    out = writeVlq(out, columnDelta);
+    *out++ = 'A';
+    out = writeVlq(out, lineDelta);
+    out = writeVlq(out, sourceColumnDelta);
+    if (nameDelta != INT64_MIN) out = writeVlq(out, nameDelta);
+    return out;
+}
+
+void MappingEncoder::flush(const std::string& code) {
+    for (const Queued& segment : queued) encode(code, segment);
+    queued.clear();
+}
+
+void MappingEncoder::encode(const std::string& code, const Queued& queuedSegment) {
+    uint32_t sourceOffset = queuedSegment.sourceOffset;
+    uint32_t nameIndex = queuedSegment.name;
+    advance(code, queuedSegment.position);
+    int64_t generatedColumn = static_cast<int64_t>(queuedSegment.position - lineStart);
+    if (lineHasSegment && generatedColumn == column) return;
+    uint32_t line;
+    uint32_t lineColumn;
+    lines->locate(sourceOffset, static_cast<uint32_t>(sourceLine), line, lineColumn);
+
+    char* out = reserve(kMaxSegmentBytes);
+    if (lineHasSegment) *out++ = ',';
+    size_t begin = static_cast<size_t>(out - mappings.data());
+    int64_t columnDelta = generatedColumn - column;
+    int64_t lineDelta = static_cast<int64_t>(line) - sourceLine;
+    int64_t sourceColumnDelta = static_cast<int64_t>(lineColumn) - sourceColumn;
+    bool named = nameIndex != kNoSourceName;
+    out = writeSegment(out, columnDelta, lineDelta, sourceColumnDelta, named ? nameIndex - name : INT64_MIN);
+    used = static_cast<size_t>(out - mappings.data());
+
+    if (!hasSegment || (named && !hasNamed)) {
+        Segment segment;
+        segment.begin = begin;
+        segment.end = used;
+        segment.columnDelta = columnDelta;
+        segment.lineDelta = lineDelta;
+        segment.sourceColumnDelta = sourceColumnDelta;
+        segment.sourceLine = line;
+        segment.sourceColumn = lineColumn;
+        if (named) segment.name = nameIndex;
+        if (!hasSegment) {
+            first = segment;
+            hasSegment = true;
+        }
+        if (named && !hasNamed) {
+            firstNamed = segment;
+            hasNamed = true;
+        }
+    }
+    lineHasSegment = true;
+    column = generatedColumn;
+    sourceLine = line;
+    sourceColumn = lineColumn;
+    if (named) name = nameIndex;
+}
+
+void MappingEncoder::finish(const std::string& code) {
+    flush(code);
+    advance(code, code.size());
+    mappings.resize(used);
+}
+
+void MappingEncoder::append(const std::string& code, const MappingEncoder& chunk, size_t chunkStart) {
+    flush(code);
+    advance(code, chunkStart);
+    // Columns on the chunk's first line count from chunkStart, which need
+    // not be the start of a line.
+    int64_t shift = static_cast<int64_t>(chunkStart - lineStart);
+    const char* text = chunk.mappings.data();
+    char* out = reserve(chunk.used + 2 * kMaxSegmentBytes);
+    if (!chunk.hasSegment) {
+        out = std::copy(text, text + chunk.used, out);
+    } else {
+        // The chunk started from all-zero state, so its first segment holds
+        // absolute values; its column is absolute within its line.
+        int64_t columnDelta = chunk.first.columnDelta;
+        if (chunk.first.begin == 0) {
+            columnDelta += shift - (lineHasSegment ? column : 0);
+            if (lineHasSegment) *out++ = ',';
+        }
+        out = std::copy(text, text + chunk.first.begin, out);
+        int64_t nameDelta = INT64_MIN;
+        if (chunk.first.name >= 0) {
+            nameDelta = chunk.first.name - name;
+            name = chunk.first.name;
+        }
+        out = writeSegment(out, columnDelta, chunk.first.sourceLine - sourceLine,
+                           chunk.first.sourceColumn - sourceColumn, nameDelta);
+        size_t copied = chunk.first.end;
+        if (chunk.hasNamed && chunk.firstNamed.begin != chunk.first.begin) {
+            // Only its name was relative to the chunk's zero state.
+            out = std::copy(text + copied, text + chunk.firstNamed.begin, out);
+            out = writeSegment(out, chunk.firstNamed.columnDelta, chunk.firstNamed.lineDelta,
+                               chunk.firstNamed.sourceColumnDelta, chunk.firstNamed.name - name);
+            copied = chunk.firstNamed.end;
+        }
+        out = std::copy(text + copied, text + chunk.used, out);
+        sourceLine = chunk.sourceLine;
+        sourceColumn = chunk.sourceColumn;
+        if (chunk.hasNamed) name = chunk.name;
+    }
+    used = static_cast<size_t>(out - mappings.data());
+    if (chunk.lineStart != 0) {
+        column = chunk.column;
+        lineHasSegment = chunk.lineHasSegment;
+        lineStart = chunkStart + chunk.lineStart;
+    } else if (chunk.lineHasSegment) {
+        column = shift + chunk.column;
+        lineHasSegment = true;
+    }
+    searched = chunkStart + chunk.searched;
+    nextBreak = SIZE_MAX;
+}
+
+void SourceMap::setPaths(const std::string& inputPath, const std::string& outputPath) {
+    fs::path output(outputPath);
+    file = output.filename().string();
+    url = file + ".map";
+    std::error_code ec;
+    fs::path relative = fs::relative(fs::path(inputPath), output.parent_path().empty() ? "." : output.parent_path(), ec);
+    source = ec || relative.empty() ? fs::absolute(inputPath, ec).generic_string() : relative.generic_string();
+}
+
+std::string SourceMap::toJson() const {
+    std::string out;
+    out.reserve(mappings.text().size() + 64 + names.size() * 8);
+    out += "{\"version\":3,\"file\":";
+    appendJsonString(out, file);
+    out += ",\"sources\":[";
+    appendJsonString(out, source);
+    out += "],\"names\":[";
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (i > 0) out += ',';
+        appendJsonString(out, names[i]);
+    }
+    out += "],\"mappings\":\"";
+    out += mappings.text();
+    out += "\"}\n";
+    return out;
+}
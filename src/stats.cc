@@ -0,0 +1,182 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-17 13:40:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-17 13:40:00 
+ */
+#include "stats.h"
+
+#if CURSIOBFUSCATOR_STATS
+
+#include <cstdio>
+#include "ast.h"
+#include "lexer.h"
+
+namespace {
+
+static_assert(static_cast<size_t>(TokenType::END) == kTokenTypeCount,
+              "kTokenTypeCount must cover every TokenType the lexer produces");
+static_assert(static_cast<size_t>(ASTNodeType::EMPTY) + 1 == kNodeTypeCount,
+              "kNodeTypeCount must cover every ASTNodeType");
+
+constexpr const char* kPhaseNames[PHASE_COUNT] = {
+    "read", "tokenize", "parse", "obfuscate", "dump", "generate", "write"
+};
+
+constexpr const char* kTokenTypeNames[kTokenTypeCount] = {
+    "identifier", "keyword", "number", "string", "operator", "symbol"
+};
+
+constexpr const char* kNodeTypeNames[kNodeTypeCount] = {
+    "program", "function_declaration", "block", "return_statement", "variable_declaration",
+    "function_call", "member_expression", "expression", "identifier", "number", "string",
+    "keyword", "if_statement", "while_statement", "for_loop", "while_loop",
+    "binary_expression", "unary_expression", "postfix_expression", "conditional_expression", "empty"
+};
+
+double cpuMilliseconds(std::clock_t from, std::clock_t to) {
+    return 1000.0 * static_cast<double>(to - from) / CLOCKS_PER_SEC;
+}
+
+uint64_t sum(const uint64_t* values, size_t count) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; ++i) total += values[i];
+    return total;
+}
+
+// Prints name/count pairs, skipping zeros, as text or as a JSON object.
+void printCounts(std::ostream& out, const char* const* names, const uint64_t* values, size_t count, bool json) {
+    bool first = true;
+    for (size_t i = 0; i < count; ++i) {
+        if (values[i] == 0) continue;
+        if (json) {
+            out << (first ? "" : ", ") << '"' << names[i] << "\": " << values[i];
+        } else {
+            out << (first ? "" : ", ") << names[i] << ' ' << values[i];
+        }
+        first = false;
+    }
+}
+
+void printText(std::ostream& out, const RunStats& stats) {
+    char line[96];
+    out << "=== Stats ===\n";
+    std::snprintf(line, sizeof(line), "%-10s %12s %12s\n", "phase", "wall ms", "cpu ms");
+    out << line;
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        if (stats.phaseCpu) {
+            std::snprintf(line, sizeof(line), "%-10s %12.3f %12.3f\n", kPhaseNames[p], stats.wallMs[p], stats.cpuMs[p]);
+        } else {
+            std::snprintf(line, sizeof(line), "%-10s %12.3f %12s\n", kPhaseNames[p], stats.wallMs[p], "-");
+        }
+        out << line;
+    }
+    std::snprintf(line, sizeof(line), "%-10s %12.3f %12.3f\n", "total", stats.totalWallMs, stats.totalCpuMs);
+    out << line;
+    out << "files " << stats.files << ", cache hits " << stats.cacheHits << '\n'
+        << "bytes in " << stats.bytesIn << ", bytes out " << stats.bytesOut << '\n'
+        << "tokens " << sum(stats.tokens, kTokenTypeCount) << ": ";
+    printCounts(out, kTokenTypeNames, stats.tokens, kTokenTypeCount, false);
+    out << "\nnodes " << sum(stats.nodes, kNodeTypeCount) << ": ";
+    printCounts(out, kNodeTypeNames, stats.nodes, kNodeTypeCount, false);
+    out << "\natoms " << stats.atoms << ", renamed names " << stats.renamedNames
+        << ", folded expressions " << stats.foldedExpressions
+        << ", string table entries " << stats.stringTableEntries << '\n'
+        << "lexer: unknown tokens " << stats.lexer.unknownTokens
+        << ", whitespace kernel runs " << stats.lexer.whitespaceRuns << '\n'
+        << "parser: errors " << stats.parser.errors
+        << ", skipped tokens " << stats.parser.skippedTokens << std::endl;
+}
+
+void printJson(std::ostream& out, const RunStats& stats) {
+    char number[32];
+    auto ms = [&number](double value) {
+        std::snprintf(number, sizeof(number), "%.3f", value);
+        return number;
+    };
+    out << "{\"phases\": {";
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        out << (p ? ", " : "") << '"' << kPhaseNames[p] << "\": {\"wall_ms\": " << ms(stats.wallMs[p]);
+        if (stats.phaseCpu) out << ", \"cpu_ms\": " << ms(stats.cpuMs[p]);
+        out << '}';
+    }
+    out << "}, \"total\": {\"wall_ms\": " << ms(stats.totalWallMs);
+    out << ", \"cpu_ms\": " << ms(stats.totalCpuMs) << '}'
+        << ", \"files\": " << stats.files
+        << ", \"cache_hits\": " << stats.cacheHits
+        << ", \"bytes_in\": " << stats.bytesIn
+        << ", \"bytes_out\": " << stats.bytesOut
+        << ", \"tokens\": {";
+    printCounts(out, kTokenTypeNames, stats.tokens, kTokenTypeCount, true);
+    out << "}, \"nodes\": {";
+    printCounts(out, kNodeTypeNames, stats.nodes, kNodeTypeCount, true);
+    out << "}, \"atoms\": " << stats.atoms
+        << ", \"renamed_names\": " << stats.renamedNames
+        << ", \"folded_expressions\": " << stats.foldedExpressions
+        << ", \"string_table_entries\": " << stats.stringTableEntries
+        << ", \"lexer\": {\"unknown_tokens\": " << stats.lexer.unknownTokens
+        << ", \"whitespace_runs\": " << stats.lexer.whitespaceRuns << '}'
+        << ", \"parser\": {\"errors\": " << stats.parser.errors
+        << ", \"skipped_tokens\": " << stats.parser.skippedTokens << "}}" << std::endl;
+}
+
+} // namespace
+
+void RunStats::countNodes(const AST& ast) {
+    for (NodeId id = 0; id < ast.size(); ++id) {
+        ++nodes[static_cast<size_t>(ast[id].type)];
+    }
+}
+
+void RunStats::merge(const RunStats& other) {
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        wallMs[p] += other.wallMs[p];
+        cpuMs[p] += other.cpuMs[p];
+    }
+    files += other.files;
+    cacheHits += other.cacheHits;
+    bytesIn += other.bytesIn;
+    bytesOut += other.bytesOut;
+    for (size_t i = 0; i < kTokenTypeCount; ++i) tokens[i] += other.tokens[i];
+    for (size_t i = 0; i < kNodeTypeCount; ++i) nodes[i] += other.nodes[i];
+    atoms += other.atoms;
+    renamedNames += other.renamedNames;
+    foldedExpressions += other.foldedExpressions;
+    stringTableEntries += other.stringTableEntries;
+    lexer.unknownTokens += other.lexer.unknownTokens;
+    lexer.whitespaceRuns += other.lexer.whitespaceRuns;
+    parser.errors += other.parser.errors;
+    parser.skippedTokens += other.parser.skippedTokens;
+}
+
+void RunStats::startTotal() {
+    totalWallStart = std::chrono::steady_clock::now();
+    totalCpuStart = std::clock();
+}
+
+void RunStats::stopTotal() {
+    totalWallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - totalWallStart).count();
+    totalCpuMs = cpuMilliseconds(totalCpuStart, std::clock());
+}
+
+PhaseTimer::PhaseTimer(RunStats* runStats, StatPhase timedPhase) : stats(runStats), phase(timedPhase) {
+    if (!stats) return;
+    wallStart = std::chrono::steady_clock::now();
+    cpuStart = std::clock();
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (!stats) return;
+    stats->wallMs[phase] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+    stats->cpuMs[phase] += cpuMilliseconds(cpuStart, std::clock());
+}
+
+void printStats(std::ostream& out, const RunStats& stats, bool json) {
+    if (json) {
+        printJson(out, stats);
+    } else {
+        printText(out, stats);
+    }
+}
+
+#endif
@@ -0,0 +1,226 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-18 09:30:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-18 09:30:00 
+ */
+// Loads damaged copies of a saved AST file. Each one must either be
+// rejected or load into a tree that every option set obfuscates, with a
+// source map, without crashing. A crash fails the test, so run it under
+// -fsanitize=address to catch the quieter ones too.
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast_file.h"
+#include "pipeline.h"
+#include "source_map.h"
+
+namespace {
+
+// Every node type the parser makes, and folds the constant folder can do.
+constexpr std::string_view kSource =
+    "function add(a, b) {\n"
+    "    return a + b * 2 - (a, b);\n"
+    "}\n"
+    "function pick(flag, list) {\n"
+    "    var total = list.length;\n"
+    "    if (flag) { total++; }\n"
+    "    while (total > 0) { total--; }\n"
+    "    return flag ? -list.first : !flag, ~total;\n"
+    "}\n"
+    "console.log(add(1, 2) + \"x\" + \"y\", pick(true, add).value, 4 + 5, -(6 - 9));\n"
+    "document.title = \"done\" + 'now';\n";
+
+constexpr size_t kMagicBytes = 8;
+constexpr size_t kHeaderWords = 9;
+constexpr size_t kNodeWords = 6;
+
+uint32_t getWord(const std::string& data, size_t at) {
+    uint32_t value;
+    std::memcpy(&value, data.data() + at, 4);
+    return value;
+}
+
+void putWord(std::string& data, size_t at, uint32_t value) {
+    std::memcpy(&data[at], &value, 4);
+}
+
+struct Layout {
+    uint32_t nodeCount;
+    size_t nodes;
+    size_t offsets;
+    size_t lines;
+    uint32_t lineCount;
+};
+
+Layout layoutOf(const std::string& data) {
+    Layout layout;
+    layout.nodeCount = getWord(data, kMagicBytes + 8);
+    uint32_t atomCount = getWord(data, kMagicBytes + 16);
+    layout.lineCount = getWord(data, kMagicBytes + 24);
+    layout.nodes = kMagicBytes + kHeaderWords * 4;
+    layout.offsets = layout.nodes + layout.nodeCount * kNodeWords * 4;
+    layout.lines = layout.offsets + (layout.nodeCount + atomCount) * 4;
+    return layout;
+}
+
+struct Options {
+    const char* name;
+    ObfuscatorOptions options;
+};
+
+const std::vector<Options>& optionSets() {
+    static const std::vector<Options> sets = [] {
+        std::vector<Options> result;
+        ObfuscatorOptions options;
+        result.push_back({ "hex", options });
+        options.names = NameStyle::SHORT;
+        options.strings = StringEncoding::SHUFFLE;
+        options.compact = true;
+        result.push_back({ "short/shuffle/compact", options });
+        options.strings = StringEncoding::XOR;
+        options.compact = false;
+        result.push_back({ "short/xor", options });
+        options.names = NameStyle::HEX;
+        options.strings = StringEncoding::BASE64;
+        result.push_back({ "hex/base64", options });
+        return result;
+    }();
+    return sets;
+}
+
+// Loads data and, when it is accepted, obfuscates it with every option set.
+// Returns whether it was accepted.
+bool exercise(const std::string& data, std::string* firstOutput = nullptr) {
+    for (const Options& set : optionSets()) {
+        ObfuscationContext context(nullptr, set.options);
+        ASTFileSource source;
+        std::string error;
+        if (!context.load(data, source, error)) return false;
+        SourceMap map;
+        map.lines.reset(std::move(source.lineStarts));
+        const std::string& code = context.obfuscate(nullptr, nullptr, &map);
+        if (firstOutput && firstOutput->empty()) *firstOutput = code;
+        map.toJson();
+    }
+    return true;
+}
+
+int failures = 0;
+
+void expectRejected(const std::string& data, const char* what) {
+    if (exercise(data)) {
+        std::cerr << "FAIL: accepted " << what << std::endl;
+        ++failures;
+    }
+}
+
+// First node of type, or UINT32_MAX.
+uint32_t findNode(const std::string& data, const Layout& layout, ASTNodeType type, uint32_t after = 0) {
+    for (uint32_t id = after; id < layout.nodeCount; ++id) {
+        if (getWord(data, layout.nodes + id * kNodeWords * 4) == static_cast<uint32_t>(type)) return id;
+    }
+    return UINT32_MAX;
+}
+
+size_t fieldAt(const Layout& layout, uint32_t id, size_t word) {
+    return layout.nodes + (id * kNodeWords + word) * 4;
+}
+
+} // namespace
+
+int main() {
+    ObfuscationContext parsed;
+    parsed.parse(kSource);
+    std::string saved;
+    parsed.save(kSource, "input.js", saved);
+
+    // The file as saved loads and obfuscates like the source it came from.
+    std::string direct = ObfuscationContext().run(kSource);
+    std::string loaded;
+    if (!exercise(saved, &loaded) || loaded != direct) {
+        std::cerr << "FAIL: the saved file does not reproduce the source's output" << std::endl;
+        return 1;
+    }
+
+    Layout layout = layoutOf(saved);
+    Atom identifier = INVALID_ATOM;
+    Atom number = INVALID_ATOM;
+    Atom string = INVALID_ATOM;
+    for (uint32_t id = 0; id < layout.nodeCount; ++id) {
+        uint32_t type = getWord(saved, fieldAt(layout, id, 0));
+        Atom value = getWord(saved, fieldAt(layout, id, 1));
+        if (type == static_cast<uint32_t>(ASTNodeType::IDENTIFIER) && value >= ATOM_WELL_KNOWN_COUNT) identifier = value;
+        if (type == static_cast<uint32_t>(ASTNodeType::NUMBER)) number = value;
+        if (type == static_cast<uint32_t>(ASTNodeType::STRING)) string = value;
+    }
+
+    // Damage that used to crash the obfuscator.
+    auto withWord = [&](size_t at, uint32_t value) {
+        std::string copy = saved;
+        putWord(copy, at, value);
+        return copy;
+    };
+    uint32_t id = findNode(saved, layout, ASTNodeType::IDENTIFIER);
+    expectRejected(withWord(fieldAt(layout, id, 1), number), "an identifier spelled like a number");
+    expectRejected(withWord(fieldAt(layout, id, 1), string), "an identifier spelled like a string");
+    id = findNode(saved, layout, ASTNodeType::NUMBER);
+    expectRejected(withWord(fieldAt(layout, id, 1), identifier), "a number spelled like an identifier");
+    id = findNode(saved, layout, ASTNodeType::STRING);
+    expectRejected(withWord(fieldAt(layout, id, 1), number), "a string spelled like a number");
+    id = findNode(saved, layout, ASTNodeType::FUNCTION_CALL);
+    expectRejected(withWord(fieldAt(layout, id, 0), static_cast<uint32_t>(ASTNodeType::MEMBER_EXPRESSION)),
+                   "a call retyped to a member");
+    id = findNode(saved, layout, ASTNodeType::UNARY_EXPRESSION);
+    expectRejected(withWord(fieldAt(layout, id, 1), ATOM_EMPTY), "a unary operator with the empty atom");
+    expectRejected(withWord(fieldAt(layout, id, 1), ATOM_STAR), "a unary '*'");
+    id = findNode(saved, layout, ASTNodeType::EXPRESSION);
+    expectRejected(withWord(fieldAt(layout, id, 1), identifier), "a binary operator spelled like an identifier");
+    id = findNode(saved, layout, ASTNodeType::POSTFIX_EXPRESSION);
+    expectRejected(withWord(fieldAt(layout, id, 1), ATOM_PLUS), "a postfix '+'");
+    id = findNode(saved, layout, ASTNodeType::CONDITIONAL_EXPRESSION);
+    expectRejected(withWord(fieldAt(layout, id, 1), ATOM_COLON), "a conditional without '?'");
+    id = findNode(saved, layout, ASTNodeType::MEMBER_EXPRESSION);
+    expectRejected(withWord(fieldAt(layout, id, 1), ATOM_PLUS), "a member without '.'");
+    expectRejected(withWord(layout.offsets, static_cast<uint32_t>(kSource.size() + 1)), "an offset past the source");
+    expectRejected(withWord(layout.lines + (layout.lineCount - 1) * 4, static_cast<uint32_t>(kSource.size() + 1)),
+                   "a line starting past the source");
+
+    // Every field of every node and every line start, set to values near
+    // the ones that matter.
+    std::vector<uint32_t> values = { 0, 1, 2, 3, INVALID_NODE, layout.nodeCount - 1, layout.nodeCount,
+                                     ATOM_PLUS, ATOM_MINUS, ATOM_NOT, ATOM_DOT, ATOM_COMMA, ATOM_ASSIGN,
+                                     ATOM_QUESTION, ATOM_INCREMENT, identifier, number, string };
+    for (uint32_t type = 0; type <= static_cast<uint32_t>(ASTNodeType::EMPTY); ++type) values.push_back(type);
+    size_t accepted = 0;
+    size_t tried = 0;
+    for (uint32_t node = 0; node < layout.nodeCount; ++node) {
+        for (size_t word = 0; word <= kNodeWords; ++word) {
+            size_t at = word < kNodeWords ? fieldAt(layout, node, word) : layout.offsets + node * 4;
+            for (uint32_t value : values) {
+                if (value == getWord(saved, at)) continue;
+                ++tried;
+                if (exercise(withWord(at, value))) ++accepted;
+            }
+        }
+    }
+    for (uint32_t line = 0; line < layout.lineCount; ++line) {
+        for (uint32_t value : { 0u, 1u, static_cast<uint32_t>(kSource.size()), static_cast<uint32_t>(kSource.size() + 1),
+                                UINT32_MAX }) {
+            ++tried;
+            if (exercise(withWord(layout.lines + line * 4, value))) ++accepted;
+        }
+    }
+    for (size_t word = 0; word < kHeaderWords; ++word) {
+        for (uint32_t value : values) {
+            ++tried;
+            if (exercise(withWord(kMagicBytes + word * 4, value))) ++accepted;
+        }
+    }
+    std::cout << tried << " damaged files, " << accepted << " still valid trees" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-18 15:20:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-18 15:20:00 
+ */
+// Drives libcursiobfuscator through include/cursiobfuscator.h only and
+// compares what it returns with ObfuscationContext run on the same options.
+// Also checks that struct_size decides which option fields are read.
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include "cursiobfuscator.h"
+#include "pipeline.h"
+
+namespace {
+
+constexpr std::string_view kSource =
+    "function greet(name, times) {\n"
+    "    var text = \"Hello, \" + name + \"\\n\";\n"
+    "    while (times > 0) { times--; }\n"
+    "    return text;\n"
+    "}\n"
+    "console.log(greet('world', 3), 'it\\'s \\u2028 done');\n";
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (ok) return;
+    std::cerr << "FAIL: " << what << std::endl;
+    ++failures;
+}
+
+std::string expected(const ObfuscatorOptions& options) {
+    ObfuscationContext context(nullptr, options);
+    return context.run(kSource);
+}
+
+// Obfuscates kSource through the C API. Returns "" when the context cannot
+// be created or the call fails.
+std::string obfuscate(const cursiobfuscator_options* options) {
+    cursiobfuscator_context* context = cursiobfuscator_context_new(options);
+    if (!context) return "";
+    const char* output = nullptr;
+    size_t outputSize = 0;
+    std::string result;
+    if (cursiobfuscator_obfuscate(context, kSource.data(), kSource.size(), &output, &outputSize) ==
+        CURSIOBFUSCATOR_OK) {
+        result.assign(output, outputSize);
+    }
+    cursiobfuscator_context_free(context);
+    return result;
+}
+
+} // namespace
+
+int main() {
+    ObfuscatorOptions defaults;
+    ObfuscatorOptions tuned;
+    tuned.strings = StringEncoding::SHUFFLE;
+    tuned.names = NameStyle::SHORT;
+    tuned.compact = true;
+
+    check(!expected(defaults).empty(), "the reference output is empty");
+    check(obfuscate(nullptr) == expected(defaults), "NULL options do not give the defaults");
+
+    cursiobfuscator_options options;
+    cursiobfuscator_options_init(&options);
+    check(options.struct_size == sizeof(options), "options_init does not set struct_size");
+    check(obfuscate(&options) == expected(defaults), "initialized options do not give the defaults");
+
+    options.string_encoding = CURSIOBFUSCATOR_STRINGS_SHUFFLE;
+    options.name_style = CURSIOBFUSCATOR_NAMES_SHORT;
+    options.compact = 1;
+    check(obfuscate(&options) == expected(tuned), "options are not passed through");
+    options.threads = 4;
+    check(obfuscate(&options) == expected(tuned), "threads change the output");
+
+    // A caller built before compact existed: compact must keep its default
+    // even though the bytes behind it are set.
+    options.struct_size = offsetof(cursiobfuscator_options, compact);
+    ObfuscatorOptions noCompact = tuned;
+    noCompact.compact = false;
+    check(obfuscate(&options) == expected(noCompact), "a field past struct_size is read");
+
+    // Fields past struct_size are not validated either.
+    options.struct_size = offsetof(cursiobfuscator_options, string_encoding);
+    options.string_encoding = 99;
+    options.name_style = 99;
+    check(obfuscate(&options) == expected(defaults), "fields past struct_size are not ignored");
+
+    options.struct_size = offsetof(cursiobfuscator_options, threads);
+    check(cursiobfuscator_context_new(&options) == nullptr, "a struct_size without threads is accepted");
+
+    cursiobfuscator_options_init(&options);
+    options.string_encoding = 99;
+    check(cursiobfuscator_context_new(&options) == nullptr, "an unknown string encoding is accepted");
+    cursiobfuscator_options_init(&options);
+    options.name_style = 99;
+    check(cursiobfuscator_context_new(&options) == nullptr, "an unknown name style is accepted");
+
+    cursiobfuscator_context* context = cursiobfuscator_context_new(nullptr);
+    check(context != nullptr, "the default context cannot be created");
+    if (context) {
+        const char* output = "";
+        size_t outputSize = 1;
+        check(cursiobfuscator_obfuscate(context, kSource.data(), kSource.size(), nullptr, &outputSize) ==
+                  CURSIOBFUSCATOR_INVALID_ARGUMENT, "a NULL output pointer is accepted");
+        check(outputSize == 0, "a failed call leaves an output size");
+        check(*cursiobfuscator_last_error(context) != '\0', "a failed call has no message");
+        check(cursiobfuscator_obfuscate(context, kSource.data(), kSource.size(), &output, &outputSize) ==
+                  CURSIOBFUSCATOR_OK, "the context does not recover from a failed call");
+        check(std::string(output, outputSize) == expected(defaults), "a reused context gives other output");
+        check(*cursiobfuscator_last_error(context) == '\0', "a successful call keeps the old message");
+        cursiobfuscator_context_reset(context);
+        check(cursiobfuscator_obfuscate(context, nullptr, 0, &output, &outputSize) == CURSIOBFUSCATOR_OK,
+              "empty input fails");
+        cursiobfuscator_context_free(context);
+    }
+    check(cursiobfuscator_obfuscate(nullptr, kSource.data(), kSource.size(), nullptr, nullptr) ==
+              CURSIOBFUSCATOR_INVALID_ARGUMENT, "a NULL context is accepted");
+    return failures == 0 ? 0 : 1;
+}
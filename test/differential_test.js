@@ -0,0 +1,354 @@
+/*
+ * @Author: Cuersy 
+ * @Date: 2026-10-18 14:10:00 
+ * @Last Modified by:   Cuersy 
+ * @Last Modified time: 2026-10-18 14:10:00 
+ */
+// Differential test: runs each case with node, obfuscates it under every
+// option set and checks the output prints the same. It also decodes each
+// source map against the input, and checks that saved AST files reproduce
+// the direct output and that damaged ones are rejected.
+//
+//   node differential_test.js <path to cursiobfuscator>
+'use strict';
+
+const { spawnSync } = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+const binary = path.resolve(process.argv[2] || 'cursiobfuscator');
+const work = fs.mkdtempSync(path.join(os.tmpdir(), 'cursiobfuscator-'));
+// Direct and --load-ast runs write to sibling directories, so their maps
+// name the input and the output the same way.
+const direct = path.join(work, 'direct');
+const fromAst = path.join(work, 'loaded');
+fs.mkdirSync(direct);
+fs.mkdirSync(fromAst);
+
+// Hex names rename every identifier but console and log, so cases that
+// read other globals or properties only run with short names.
+const optionSets = [
+    { name: 'hex', args: [], globals: false },
+    { name: 'short', args: ['--names', 'short'], globals: true },
+    { name: 'short/shuffle/compact', args: ['--names', 'short', '--strings', 'shuffle', '--compact'], globals: true },
+    { name: 'hex/xor/compact', args: ['--strings', 'xor', '--compact'], globals: false },
+    { name: 'short/base64/-j 4', args: ['--names', 'short', '--strings', 'base64', '-j', '4'], globals: true },
+];
+
+function repeat(text, count) {
+    return new Array(count + 1).join(text);
+}
+
+const cases = [
+    {
+        name: 'precedence',
+        globals: false,
+        source: [
+            'function f(a, b) { return a - (b - 1) * (a + b) / (2 - a) % 3; }',
+            'function g(a, b, c) { return (a, b) ? (c = a) : b = c; }',
+            'function h(a) { return -(-a) + - -a + -(--a) + +(+a) + !!a + ~~a + (a = 2, a); }',
+            'function k(a, b) { return a && b || !a && !b ? a | b ^ a & b : a << 2 >> 1 >>> 0; }',
+            'function m(a, b) { return a == b != (a === b) !== (a < b) > (a <= b) >= (a > b); }',
+            'function p(a) { return a++ + ++a - a-- - --a + (a++) * 2; }',
+            'function q(a, b) { return (a ? b : a) ? a : b ? 1 : 2; }',
+            'function r(a, b, c) { a = b = c; a += b -= 1; a *= 2; a <<= 1; a |= 1; return (a, b, c); }',
+            'console.log(f(5, 2), f(1, 9), g(1, 0, 3), g(0, 0, 3), h(4), k(3, 5), k(0, 0), k(1, 0));',
+            'console.log(m(1, 2), m(2, 2), p(3), q(0, 1), q(1, 0), r(1, 2, 3), (1, 2), 2 * (3 + 4), 1 - (2 - 3));',
+            'console.log(10 - 4 - 3, 10 - (4 - 3), 2 * 3 % 4, 2 * (3 % 4), -(6 - 9), -(-5), 1 ? 0 ? 2 : 3 : 4);',
+        ].join('\n'),
+    },
+    {
+        name: 'compact spacing',
+        globals: false,
+        source: [
+            'x = 5;',
+            'y = 7;',
+            'console.log(x + +y, x - -y, x - --y, x + ++y, x < !y, x++ + ++x, x-- - --x, x - -1, - -x, + +x);',
+            'console.log(x+ +y, x- -y, x+ + +y, x- - -y, -(-x), +(+x), -(--x), +(++x), x < !!y, !x < y);',
+        ].join('\n'),
+    },
+    {
+        name: 'numbers',
+        globals: false,
+        source: [
+            'function half(a) { return a * 0.5 + 1e3 - 2.5e-1 + 1E2; }',
+            'console.log(half(4), 0.25, 100, 3.0, 1e21, 010 + 1, 08 + 1, 0 + 1, -010, 7 / 2, 10 % 3, 2 - 5);',
+        ].join('\n'),
+    },
+    {
+        name: 'strings',
+        globals: false,
+        source: [
+            'function greet(name) { return "hello " + name + "!" + " " + "twice" + "twice"; }',
+            'function quoted(a) { return a + \'single\' + "a\\"b" + \'say "hi"\' + "it\'s" + \'\\\'\'; }',
+            'console.log(greet("you"), greet(\'me\'), quoted(1), "tab\\there", "nl\\nhere", "back\\\\slash");',
+            'console.log("unié", "é", "€", "😀", "\\x41\\101\\u0042\\u{1F600}\\q", "\\uD800" + "x");',
+            'console.log("" + "x" + "y", "n" + 1 + 2, 1 + 2 + "n", "a" + -1, "done" + \'now\');',
+        ].join('\n'),
+    },
+    {
+        name: 'scopes',
+        globals: true,
+        source: [
+            'function counter(start) {',
+            '    function step(by) { start = start + by; return start; }',
+            '    function twice(by) { return step(by) + step(by); }',
+            '    return twice(1) * 100 + step(10);',
+            '}',
+            'function shadow(console, x) { return x + console; }',
+            'function outer(a) {',
+            '    function inner(b) { function deepest(a) { return a * b; } return deepest(b + a) - a; }',
+            '    return inner(a + 1);',
+            '}',
+            'function sibling1(q, r) { return q - r; }',
+            'function sibling2(r, q) { return q - r; }',
+            'function rec(n) { return n < 1 ? 0 : n + rec(n - 1); }',
+            'g = 2;',
+            'function usesGlobal(h) { return g * h + Math.max(h, g); }',
+            'console.log(counter(5), shadow(1, 2), outer(3), sibling1(1, 2), sibling2(1, 2), rec(10));',
+            'console.log(usesGlobal(4), "abc".length, Math.PI > 3, Math.min(3, g));',
+        ].join('\n'),
+    },
+    {
+        // As deep as node itself parses; deeperThanNode goes further.
+        name: 'deep nesting',
+        globals: false,
+        source: [
+            'function id(v) { return v; }',
+            'console.log(' + repeat('(', 1000) + '1' + repeat(' + 1)', 1000) + ');',
+            'console.log(' + repeat('-(', 1000) + '2' + repeat(')', 1000) + ');',
+            'console.log(' + repeat('id(', 1000) + '"deep"' + repeat(')', 1000) + ');',
+            'console.log(' + repeat('!', 1000) + '1);',
+            'console.log(1' + repeat(' - 1', 1000) + ');',
+            'console.log(' + repeat('0 ? 1 : ', 1000) + '5);',
+            'x = 1;',
+            'console.log(' + repeat('-x - ', 1000) + '-x);',
+        ].join('\n'),
+    },
+    {
+        // Large enough for -j 4 to split it into chunks.
+        name: 'chunks',
+        globals: false,
+        source: (() => {
+            const lines = ['function mix(a, b) { return a * 31 + b; }'];
+            for (let i = 0; i < 6000; ++i) {
+                lines.push('console.log(mix(' + i + ', ' + (i % 7) + ') - ' + i + ', "s' + (i % 50) + '" + "t", -' +
+                           i + ');');
+            }
+            return lines.join('\n');
+        })(),
+    },
+    {
+        // The map must point the stack trace back at the input.
+        name: 'stack trace',
+        globals: false,
+        throws: true,
+        source: [
+            'function fail(value) {',
+            '    return value.missing.field;',
+            '}',
+            'console.log("before");',
+            'fail(0);',
+        ].join('\n'),
+    },
+];
+
+// Too deep for node to run, but the obfuscator must still get through it.
+const deeperThanNode = [
+    'console.log(' + repeat('(', 100000) + '1' + repeat(' + 1)', 100000) + ');',
+    'console.log(' + repeat('-(', 100000) + '2' + repeat(')', 100000) + ');',
+    'console.log(' + repeat('0 ? 1 : ', 100000) + '5);',
+].join('\n');
+
+let failures = 0;
+
+function fail(message) {
+    console.error('FAIL: ' + message);
+    ++failures;
+}
+
+function runNode(file, extra) {
+    return spawnSync(process.execPath, (extra || []).concat([file]), { encoding: 'utf8', maxBuffer: 1 << 28 });
+}
+
+function obfuscate(args) {
+    return spawnSync(binary, args, { encoding: 'utf8', maxBuffer: 1 << 28 });
+}
+
+const kBase64 = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/';
+
+// Decodes v3 mappings into absolute [line, column, source, sourceLine,
+// sourceColumn, name] segments, throwing on malformed VLQ.
+function decodeMappings(mappings) {
+    const segments = [];
+    const state = [0, 0, 0, 0];
+    let line = 0;
+    for (const group of mappings.split(';')) {
+        let column = 0;
+        if (group !== '') {
+            for (const text of group.split(',')) {
+                const fields = [];
+                let value = 0;
+                let shift = 0;
+                for (const c of text) {
+                    const digit = kBase64.indexOf(c);
+                    if (digit < 0) throw new Error('bad VLQ digit ' + c);
+                    value += (digit & 31) << shift;
+                    if (digit & 32) {
+                        shift += 5;
+                        continue;
+                    }
+                    fields.push(value & 1 ? -(value >>> 1) : value >>> 1);
+                    value = 0;
+                    shift = 0;
+                }
+                if (shift !== 0) throw new Error('unterminated VLQ in ' + text);
+                if (fields.length !== 1 && fields.length !== 4 && fields.length !== 5) {
+                    throw new Error('segment with ' + fields.length + ' fields');
+                }
+                column += fields[0];
+                const segment = [line, column];
+                if (fields.length > 1) {
+                    for (let i = 0; i < 3; ++i) segment.push(state[i] += fields[i + 1]);
+                    segment.push(fields.length === 5 ? (state[3] += fields[4]) : -1);
+                }
+                segments.push(segment);
+            }
+        }
+        ++line;
+    }
+    return segments;
+}
+
+function checkMap(label, input, source, output, mapFile) {
+    let map;
+    try {
+        map = JSON.parse(fs.readFileSync(mapFile, 'utf8'));
+    } catch (error) {
+        return fail(label + ': unreadable map: ' + error.message);
+    }
+    if (map.version !== 3 || map.sources.length !== 1) return fail(label + ': not a v3 map of one source');
+    if (path.resolve(path.dirname(mapFile), map.sources[0]) !== input) {
+        return fail(label + ': map source ' + map.sources[0] + ' is not the input');
+    }
+    let segments;
+    try {
+        segments = decodeMappings(map.mappings);
+    } catch (error) {
+        return fail(label + ': ' + error.message);
+    }
+    const sourceLines = source.split('\n');
+    const outputLines = output.split('\n');
+    let previous = null;
+    for (const [line, column, index, sourceLine, sourceColumn, name] of segments) {
+        const where = label + ': segment at ' + (line + 1) + ':' + column;
+        if (previous && previous[0] === line && previous[1] >= column) return fail(where + ' is out of order');
+        previous = [line, column];
+        if (line >= outputLines.length || column >= outputLines[line].length || /\s/.test(outputLines[line][column])) {
+            return fail(where + ' is not on generated code');
+        }
+        if (index !== 0 || sourceLine >= sourceLines.length) return fail(where + ' points past the input');
+        const rest = sourceLines[sourceLine].slice(sourceColumn);
+        if (rest === '' || /^\s/.test(rest)) return fail(where + ' does not point at a source token');
+        if (name >= 0 && !rest.startsWith(map.names[name])) {
+            return fail(where + ' is named ' + map.names[name] + ' but points at ' + rest.slice(0, 20));
+        }
+        if (rest.startsWith('return') && !outputLines[line].startsWith('return', column)) {
+            return fail(where + ' maps a return to ' + outputLines[line].slice(column, column + 20));
+        }
+    }
+    if (segments.length === 0) fail(label + ': empty map');
+}
+
+for (const testCase of cases) {
+    const input = path.join(work, testCase.name.replace(/\W+/g, '_') + '.js');
+    fs.writeFileSync(input, testCase.source + '\n');
+    const expected = runNode(input);
+    if (testCase.throws ? expected.status === 0 : expected.status !== 0) {
+        fail(testCase.name + ': the input itself does not run as expected: ' + expected.stderr);
+        continue;
+    }
+    const ast = input + '.ast';
+    const saved = obfuscate(['--save-ast', ast, '-o', path.join(work, 'saved.js'), input]);
+    if (saved.status !== 0) fail(testCase.name + ': --save-ast failed: ' + saved.stderr);
+
+    for (const set of optionSets) {
+        if (testCase.globals && !set.globals) continue;
+        const label = testCase.name + ' [' + set.name + ']';
+        const output = path.join(direct, 'out.js');
+        const result = obfuscate(set.args.concat(['--source-map', '-o', output, input]));
+        if (result.status !== 0) {
+            fail(label + ': obfuscator failed: ' + result.stderr);
+            continue;
+        }
+        const code = fs.readFileSync(output, 'utf8');
+        const actual = runNode(output);
+        if (actual.stdout !== expected.stdout || (actual.status === 0) !== (expected.status === 0)) {
+            fail(label + ': prints\n' + actual.stdout.slice(0, 400) + actual.stderr.slice(0, 400) +
+                 '\nbut the input prints\n' + expected.stdout.slice(0, 400));
+        }
+        if (set.args.includes('--compact') && code.split('\n').filter((line) => line !== '').length !== 2) {
+            fail(label + ': compact output is not one line of code and the map comment');
+        }
+        checkMap(label, input, testCase.source, code, output + '.map');
+
+        if (testCase.throws) {
+            // Where the input throws, by its own stack trace.
+            const at = new RegExp(input.replace(/[.*+?^${}()|[\]\\]/g, '\\$&') + ':(\\d+):\\d+');
+            const want = at.exec(expected.stderr);
+            const got = at.exec(runNode(output, ['--enable-source-maps']).stderr);
+            if (!want || !got || got[1] !== want[1]) {
+                fail(label + ': stack trace points at ' + (got ? got[0] : 'nothing') + ', not line ' +
+                     (want ? want[1] : '?'));
+            }
+        }
+
+        // The saved tree obfuscates to the same code and map.
+        const loadedOutput = path.join(fromAst, 'out.js');
+        const loaded = obfuscate(set.args.concat(['--source-map', '--load-ast', ast, '-o', loadedOutput]));
+        if (loaded.status !== 0) {
+            fail(label + ': --load-ast failed: ' + loaded.stderr);
+        } else if (fs.readFileSync(loadedOutput, 'utf8') !== code ||
+                   fs.readFileSync(loadedOutput + '.map', 'utf8') !== fs.readFileSync(output + '.map', 'utf8')) {
+            fail(label + ': --load-ast does not reproduce the direct output');
+        }
+    }
+
+    // Damaged AST files are refused and write nothing.
+    const data = fs.readFileSync(ast);
+    const withWord = (offset, value) => {
+        const copy = Buffer.from(data);
+        copy.writeUInt32LE(value, offset);
+        return copy;
+    };
+    // The header's words follow the 8-byte magic: version first, root fourth.
+    const damaged = [
+        ['truncated', data.subarray(0, data.length - 1)],
+        ['bad magic', Buffer.concat([Buffer.from('X'), data.subarray(1)])],
+        ['other version', withWord(8, data.readUInt32LE(8) + 1)],
+        ['root out of range', withWord(20, 0x7fffffff)],
+    ];
+    for (const [what, bytes] of damaged) {
+        const file = path.join(work, 'damaged.ast');
+        const output = path.join(work, 'damaged.js');
+        fs.writeFileSync(file, bytes);
+        fs.rmSync(output, { force: true });
+        const result = obfuscate(['--load-ast', file, '-o', output]);
+        if (result.status === 0 || fs.existsSync(output)) fail(testCase.name + ': accepted a ' + what + ' AST file');
+    }
+}
+
+const deepInput = path.join(work, 'deeper.js');
+fs.writeFileSync(deepInput, deeperThanNode + '\n');
+for (const set of optionSets) {
+    const result = obfuscate(set.args.concat(['--source-map', '-o', path.join(direct, 'deeper.js'), deepInput]));
+    if (result.status !== 0) fail('deeper than node [' + set.name + ']: obfuscator failed: ' + result.stderr);
+}
+
+fs.rmSync(work, { recursive: true, force: true });
+if (failures > 0) {
+    console.error(failures + ' failures');
+    process.exit(1);
+}
+console.log(cases.length + ' cases passed under ' + optionSets.length + ' option sets');
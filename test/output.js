@@ -4,5 +4,5 @@
   function _0x000000(_0x001234) {
     return _0x00369c(0x1);
   }
-  console.log((_0x000000(13) + _0x000000(11111)));
+  console.log(_0x000000(13) + _0x000000(11111));
 })(0x1,(0xB-0x2));